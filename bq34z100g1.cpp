@@ -8,801 +8,1056 @@
 
 #include "bq34z100g1.hpp"
 
-const uint8_t BQ34Z100_G1_ADDRESS = 0x55;
+static_assert(sizeof(BQ34Z100G1::Snapshot) == 0x3e - 0x02, "Snapshot layout");
+static_assert(sizeof(BQ34Z100G1::ExtendedSnapshot) == 0x76 - 0x62, "ExtendedSnapshot layout");
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "Snapshot is decoded in place");
 
-uint16_t BQ34Z100G1::read_register(uint8_t address, uint8_t length) {
-    Wire.beginTransmission(BQ34Z100_G1_ADDRESS);
-    Wire.write(address);
-    Wire.endTransmission(false);
-    Wire.requestFrom(BQ34Z100_G1_ADDRESS, length, true);
-    uint16_t temp = 0;
-    for (uint8_t i = 0; i < length; i++) {
-        temp |= Wire.read() << (8 * i);
+BQ34Z100G1::BQ34Z100G1(const BQ34Z100G1_BUS &bus, uint8_t device) : bus(bus), device(device), flash_block(flash_cache), flash_cache_age(0), flash_batch(false), flash_cache_overflow(false), flash_update_rejected(false), unlocked(false), completion_poll_interval(5), completion_timeout(2000), last_flash_write_time(0), last_reset_time(0), calibration_samples(50), calibration_sample_interval(150), calibration_outlier_limit(0), identity_valid(false), identity_time(0), identity_ttl(0), retry_limit(2), operation_deadline(0), operation_start(0), operation_open(false), operation_count(0), operation_status(BQ34Z100G1_STATUS_OK), transfer_status(BQ34Z100G1_STATUS_OK) {
+    memset(flash_cache, 0, sizeof(flash_cache));
+}
+
+BQ34Z100G1::Operation::Operation(BQ34Z100G1 &gauge) : gauge(gauge), outer(!gauge.operation_open) {
+    if (outer) {
+        gauge.operation_open = true;
+        gauge.operation_count++;
+        gauge.operation_start = gauge.bus.millis();
+        gauge.operation_status = BQ34Z100G1_STATUS_OK;
+    }
+}
+
+BQ34Z100G1::Operation::~Operation() {
+    if (outer) {
+        gauge.operation_open = false;
+    }
+}
+
+bool BQ34Z100G1::expired() {
+    return operation_open && operation_deadline && bus.millis() - operation_start >= operation_deadline;
+}
+
+BQ34Z100G1Status BQ34Z100G1::failed(BQ34Z100G1Status status) {
+    if (operation_status == BQ34Z100G1_STATUS_OK) {
+        operation_status = status;
+    }
+    return status;
+}
+
+void BQ34Z100G1::set_retry_policy(uint8_t retries, uint16_t deadline) {
+    retry_limit = retries;
+    operation_deadline = deadline;
+}
+
+BQ34Z100G1Status BQ34Z100G1::last_status() {
+    return operation_status;
+}
+
+BQ34Z100G1Status BQ34Z100G1::read_block(uint8_t address, uint8_t *data, uint8_t length) {
+    transfer_status = BQ34Z100G1_STATUS_TIMEOUT;
+    for (uint8_t attempt = 0; attempt <= retry_limit && !expired(); attempt++) {
+        if (transfer_status == BQ34Z100G1_STATUS_TIMEOUT && attempt > 0) {
+            bus.recover();
+        }
+        transfer_status = bus.read(device, address, data, length);
+        if (transfer_status == BQ34Z100G1_STATUS_OK) {
+            return transfer_status;
+        }
     }
-    return temp;
+    memset(data, 0, length); // No partial or stale data
+    return failed(transfer_status);
+}
+
+uint16_t BQ34Z100G1::read_register(uint8_t address, uint8_t length) {
+    uint8_t data[2] = {0, 0};
+    read_block(address, data, length);
+    return data[0] | (data[1] << 8);
 }
 
 uint16_t BQ34Z100G1::read_control(uint8_t address_lsb, uint8_t address_msb) {
-    Wire.beginTransmission(BQ34Z100_G1_ADDRESS);
-    Wire.write(0x00);
-    Wire.write(address_lsb);
-    Wire.write(address_msb);
-    Wire.endTransmission(true);
+    BQ34Z100G1_OPERATION(*this);
+    uint8_t data[2] = {address_lsb, address_msb};
+    if (write_block(0x00, data, 2) != BQ34Z100G1_STATUS_OK) {
+        return 0;
+    }
     return read_register(0x00, 2);
 }
 
-void BQ34Z100G1::read_flash_block(uint8_t sub_class, uint8_t offset) {
-    write_reg(0x61, 0x00); // Block control
-    write_reg(0x3e, sub_class); // Flash class
-    write_reg(0x3f, offset / 32); // Flash block
-    
-    Wire.beginTransmission(BQ34Z100_G1_ADDRESS);
-    Wire.write(0x40); // Block data
-    Wire.requestFrom(BQ34Z100_G1_ADDRESS, 32, true);
-    for (uint8_t i = 0; i < 32; i++) {
-        flash_block_data[i] = Wire.read(); // Data
+// Subclasses the gauge writes while running: Data holds the cycle count,
+// Lifetime its min/max history, State Qmax and Update Status, R_a0 and
+// R_a0x the learned impedance.
+static bool updated_by_gauge(uint8_t sub_class) {
+    switch (sub_class) {
+        case 48:
+        case 59:
+        case 60:
+        case 82:
+        case 83:
+        case 84:
+            return true;
+        default:
+            return false;
     }
 }
 
-void BQ34Z100G1::write_reg(uint8_t addr, uint8_t val) {
-    Wire.beginTransmission(BQ34Z100_G1_ADDRESS);
-    Wire.write(addr);
-    Wire.write(val);
-    Wire.endTransmission(true);
+void BQ34Z100G1::read_flash_block(uint8_t sub_class, uint8_t offset) {
+    uint8_t block = offset / 32;
+    FlashBlock *victim = &flash_cache[0];
+    for (uint8_t n = 0; n < BQ34Z100G1_FLASH_CACHE_BLOCKS; n++) {
+        FlashBlock &entry = flash_cache[n];
+        if (entry.valid && entry.sub_class == sub_class && entry.block == block) {
+            if (updated_by_gauge(sub_class) && entry.operation != operation_count && !entry.dirty && !entry.written) {
+                fetch_flash_block(entry); // Fetched by an earlier call, may be stale
+            }
+            flash_block = &entry;
+            flash_block->age = ++flash_cache_age;
+            return;
+        }
+        // Prefer a free entry, then the least recently used one.
+        bool busy = entry.valid || entry.written;
+        bool victim_busy = victim->valid || victim->written;
+        if ((victim_busy && !busy) || (busy == victim_busy && (uint8_t)(flash_cache_age - entry.age) > (uint8_t)(flash_cache_age - victim->age))) {
+            victim = &entry;
+        }
+    }
+    
+    if (victim->dirty) {
+        flush_flash_block(*victim);
+    }
+    if (victim->written) {
+        flash_cache_overflow = true; // Evicted before it could be verified
+    }
+    
+    victim->sub_class = sub_class;
+    victim->block = block;
+    victim->dirty = 0;
+    victim->written = 0;
+    fetch_flash_block(*victim);
+    flash_block = victim;
+    flash_block->age = ++flash_cache_age;
 }
 
-void BQ34Z100G1::write_flash_block(uint8_t sub_class, uint8_t offset) {
+void BQ34Z100G1::fetch_flash_block(FlashBlock &entry) {
+    if (!unlocked) {
+        unsealed();
+    }
     write_reg(0x61, 0x00); // Block control
-    write_reg(0x3e, sub_class); // Flash class
-    write_reg(0x3f, offset / 32); // Flash block
+    write_reg(0x3e, entry.sub_class); // Flash class
+    write_reg(0x3f, entry.block); // Flash block
     
-    Wire.beginTransmission(BQ34Z100_G1_ADDRESS);
-    Wire.write(0x40); // Block data
-    for (uint8_t i = 0; i < 32; i++) {
-        Wire.write(flash_block_data[i]); // Data
+    entry.operation = operation_count;
+    entry.valid = read_block(0x40, entry.data, 32) == BQ34Z100G1_STATUS_OK; // Block data
+}
+
+void BQ34Z100G1::write_reg(uint8_t addr, uint8_t val) {
+    write_block(addr, &val, 1);
+}
+
+BQ34Z100G1Status BQ34Z100G1::write_block(uint8_t address, const uint8_t *data, uint8_t length) {
+    transfer_status = BQ34Z100G1_STATUS_TIMEOUT;
+    for (uint8_t attempt = 0; attempt <= retry_limit && !expired(); attempt++) {
+        if (transfer_status == BQ34Z100G1_STATUS_TIMEOUT && attempt > 0) {
+            bus.recover();
+        }
+        transfer_status = bus.write(device, address, data, length);
+        if (transfer_status == BQ34Z100G1_STATUS_OK) {
+            return transfer_status;
+        }
     }
-    Wire.endTransmission(true);
+    return failed(transfer_status);
 }
 
-uint8_t BQ34Z100G1::flash_block_checksum() {
+uint8_t BQ34Z100G1::flash_block_checksum(const uint8_t *data) {
     uint8_t temp = 0;
     for (uint8_t i = 0; i < 32; i++) {
-        temp += flash_block_data[i];
+        temp += data[i];
     }
     return 255 - temp;
 }
 
-double BQ34Z100G1::xemics_to_double(uint32_t value) {
-    bool is_negetive = false;
-    if (value & 0x800000) {
-        is_negetive = true;
-    }
-    int16_t exp_gain = (value >> 24) - 128 - 24;
-    double exponent = pow(2, exp_gain);
-    double mantissa = (int32_t)((value & 0xffffff) | 0x800000);
-    if (is_negetive) {
-        return mantissa * exponent * -1;
+void BQ34Z100G1::set_flash_byte(uint8_t offset, uint8_t value) {
+    if (flash_block->data[offset] != value) {
+        flash_block->data[offset] = value;
+        flash_block->dirty |= 1UL << offset;
     }
-    return mantissa * exponent;
 }
 
-uint32_t BQ34Z100G1::double_to_xemics(double value) {
-    bool is_negetive = false;
-    if (value < 0) {
-        is_negetive = true;
-        value *= -1;
-    }
-    int8_t exponent;
-    if (value > 1) {
-        exponent = (log(value) / log(2)) + 1;
-    } else {
-        exponent = (log(value) / log(2));
+bool BQ34Z100G1::flush_flash_block(FlashBlock &entry) {
+    write_reg(0x61, 0x00); // Block control
+    write_reg(0x3e, entry.sub_class); // Flash class
+    write_reg(0x3f, entry.block); // Flash block
+    
+    // Unchanged bytes between the first and last dirty byte already match
+    // the gauge buffer, so the whole span goes out in one transaction.
+    uint8_t first = 0;
+    while (!(entry.dirty & (1UL << first))) {
+        first++;
     }
-    double mantissa = value / (pow(2, (double)exponent) * pow(2, -24));
-    if (is_negetive) {
-        return (((exponent + 128) << 24) | (uint32_t)mantissa) | 0x800000;
+    uint8_t last = 31;
+    while (!(entry.dirty & (1UL << last))) {
+        last--;
     }
-    return ((exponent + 128) << 24) | ((uint32_t)mantissa & 0x7fffff);
-}
-
-void BQ34Z100G1::unsealed() {
-    Wire.beginTransmission(BQ34Z100_G1_ADDRESS);
-    Wire.write(0x00); // Control
-    Wire.write(0x14);
-    Wire.write(0x04);
-    Wire.endTransmission();
+    write_block(0x40 + first, entry.data + first, last - first + 1); // Block data
+    uint8_t checksum = flash_block_checksum(entry.data);
+    write_reg(0x60, checksum);
+    bool accepted = wait_flash_write(checksum);
     
-    Wire.beginTransmission(BQ34Z100_G1_ADDRESS);
-    Wire.write(0x00); // Control
-    Wire.write(0x72);
-    Wire.write(0x36);
-    Wire.endTransmission();
+    entry.written |= entry.dirty;
+    entry.dirty = 0;
+    return accepted;
 }
 
-void BQ34Z100G1::enter_calibration() {
-    unsealed();
-    do {
-        cal_enable();
-        enter_cal();
-        delay(1000);
-    } while (!(control_status() & 0x1000)); // CALEN
+void BQ34Z100G1::flush_flash_blocks() {
+    for (uint8_t n = 0; n < BQ34Z100G1_FLASH_CACHE_BLOCKS; n++) {
+        if (flash_cache[n].dirty) {
+            flush_flash_block(flash_cache[n]);
+        }
+    }
 }
 
-void BQ34Z100G1::exit_calibration() {
-    do {
-        exit_cal();
-        delay(1000);
-    } while (!(control_status() &~ 0x1000)); // CALEN
-    
-    delay(150);
-    reset();
-    delay(150);
+bool BQ34Z100G1::verify_flash_blocks() {
+    bool verified = !flash_cache_overflow;
+    for (uint8_t n = 0; n < BQ34Z100G1_FLASH_CACHE_BLOCKS; n++) {
+        FlashBlock &entry = flash_cache[n];
+        if (!entry.written) {
+            continue;
+        }
+        uint8_t expected[32];
+        memcpy(expected, entry.data, 32);
+        fetch_flash_block(entry);
+        for (uint8_t i = 0; i < 32; i++) {
+            if ((entry.written & (1UL << i)) && entry.data[i] != expected[i]) {
+                verified = false;
+                failed(BQ34Z100G1_STATUS_CHECKSUM);
+            }
+        }
+        entry.written = 0;
+    }
+    flash_cache_overflow = false;
+    return verified;
 }
 
-bool BQ34Z100G1::update_design_capacity(int16_t capacity) {
-    unsealed();
-    read_flash_block(48, 0);
-    
-    flash_block_data[6] = 0; // Cycle Count
-    flash_block_data[7] = 0;
-    
-    flash_block_data[8] = capacity >> 8; // CC Threshold
-    flash_block_data[9] = capacity & 0xff;
-    
-    flash_block_data[11] = capacity >> 8; // Design Capacity
-    flash_block_data[12] = capacity & 0xff;
-    
-    for (uint8_t i = 6; i <= 9; i++) {
-        write_reg(0x40 + i, flash_block_data[i]);
-    }
-    
-    for (uint8_t i = 11; i <= 12; i++) {
-        write_reg(0x40 + i, flash_block_data[i]);
+bool BQ34Z100G1::commit_flash_update() {
+    if (flash_batch) {
+        return !flash_update_rejected;
     }
-    
-    write_reg(0x60, flash_block_checksum());
-    
-    delay(150);
-    reset();
-    delay(150);
-    
-    unsealed();
-    read_flash_block(48, 0);
-    int16_t updated_cc_threshold = flash_block_data[8] << 8;
-    updated_cc_threshold |= flash_block_data[9];
-    
-    int16_t updated_capacity = flash_block_data[11] << 8;
-    updated_capacity |= flash_block_data[12];
-    
-    if (flash_block_data[6] != 0 || flash_block_data[7] != 0) {
+    if (flash_update_rejected) {
+        discard_flash_update();
         return false;
     }
-    if (capacity != updated_cc_threshold) {
-        return false;
+    bool changed = flash_cache_overflow;
+    for (uint8_t n = 0; n < BQ34Z100G1_FLASH_CACHE_BLOCKS; n++) {
+        changed |= flash_cache[n].dirty || flash_cache[n].written;
     }
-    if (capacity != updated_capacity) {
-        return false;
+    if (!changed) {
+        return true;
     }
-    return true;
+    flush_flash_blocks();
+    bool restarted = reset_and_wait();
+    
+    return verify_flash_blocks() && restarted;
 }
 
-bool BQ34Z100G1::update_q_max(int16_t capacity) {
-    unsealed();
-    read_flash_block(82, 0);
-    flash_block_data[0] = capacity >> 8; // Q Max
-    flash_block_data[1] = capacity & 0xff;
-    
-    flash_block_data[2] = 0; // Cycle Count
-    flash_block_data[3] = 0;
-    
-    for (uint8_t i = 0; i <= 3; i++) {
-        write_reg(0x40 + i, flash_block_data[i]);
+void BQ34Z100G1::discard_flash_update() {
+    for (uint8_t n = 0; n < BQ34Z100G1_FLASH_CACHE_BLOCKS; n++) {
+        if (flash_cache[n].dirty) {
+            flash_cache[n].valid = false; // Patched data no longer matches the gauge
+            flash_cache[n].dirty = 0;
+        }
     }
-    
-    write_reg(0x60, flash_block_checksum());
-    
-    delay(150);
+    flash_update_rejected = false;
+}
+
+bool BQ34Z100G1::wait_flash_write(uint8_t checksum) {
+    uint32_t start = bus.millis();
+    do {
+        bus.delay(completion_poll_interval);
+        uint8_t readback;
+        // The gauge does not acknowledge while writing, so no retries here.
+        if (bus.read(device, 0x60, &readback, 1) == BQ34Z100G1_STATUS_OK && readback == checksum) {
+            last_flash_write_time = bus.millis() - start;
+            return true;
+        }
+    } while (bus.millis() - start < completion_timeout && !expired());
+    last_flash_write_time = bus.millis() - start;
+    failed(BQ34Z100G1_STATUS_CHECKSUM);
+    return false;
+}
+
+bool BQ34Z100G1::reset_and_wait() {
+    uint16_t resets = reset_data();
+    uint32_t start = bus.millis();
+    
+    // The gauge does not acknowledge while it restarts; each poll is a retry.
+    BQ34Z100G1Status status = operation_status;
+    uint8_t retries = retry_limit;
+    retry_limit = 0;
     reset();
-    delay(150);
-    
-    unsealed();
-    read_flash_block(82, 0);
-    int16_t updated_q_max = flash_block_data[0] << 8;
-    updated_q_max |= flash_block_data[1];
-    
-    if (capacity != updated_q_max) {
-        return false;
+    bool restarted = false;
+    do {
+        bus.delay(completion_poll_interval);
+        restarted = reset_data() == (uint16_t)(resets + 1) && transfer_status == BQ34Z100G1_STATUS_OK;
+    } while (!restarted && bus.millis() - start < completion_timeout && !expired());
+    last_reset_time = bus.millis() - start;
+    retry_limit = retries;
+    operation_status = status;
+    if (!restarted) {
+        failed(BQ34Z100G1_STATUS_TIMEOUT);
     }
-    return true;
+    return restarted;
 }
 
-bool BQ34Z100G1::update_design_energy(int16_t energy) {
-    unsealed();
-    read_flash_block(48, 0);
-    flash_block_data[13] = energy >> 8; // Design Energy
-    flash_block_data[14] = energy & 0xff;
-    
-    for (uint8_t i = 13; i <= 14; i++) {
-        write_reg(0x40 + i, flash_block_data[i]);
+void BQ34Z100G1::set_completion_polling(uint16_t interval, uint16_t timeout) {
+    completion_poll_interval = interval;
+    completion_timeout = timeout;
+}
+
+uint16_t BQ34Z100G1::flash_write_time() {
+    return last_flash_write_time;
+}
+
+uint16_t BQ34Z100G1::reset_time() {
+    return last_reset_time;
+}
+
+void BQ34Z100G1::invalidate_flash_cache() {
+    unlocked = false; // Whatever changed the flash may have sealed the gauge too
+    for (uint8_t n = 0; n < BQ34Z100G1_FLASH_CACHE_BLOCKS; n++) {
+        flash_cache[n].valid = false;
+        flash_cache[n].dirty = 0;
     }
+}
+
+void BQ34Z100G1::begin_flash_update() {
+    flash_batch = true;
+}
+
+bool BQ34Z100G1::end_flash_update() {
+    BQ34Z100G1_OPERATION(*this);
+    flash_batch = false;
+    return commit_flash_update();
+}
+
+double BQ34Z100G1::xemics_to_double(uint32_t value) {
+    uint32_t bits = xemics_to_ieee754(value);
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+uint32_t BQ34Z100G1::double_to_xemics(double value) {
+    float single = value;
+    uint32_t bits;
+    memcpy(&bits, &single, sizeof(bits));
+    return ieee754_to_xemics(bits);
+}
+
+void BQ34Z100G1::unsealed() {
+    uint8_t key_1[2] = {0x14, 0x04};
+    write_block(0x00, key_1, 2); // Control
     
-    write_reg(0x60, flash_block_checksum());
-    
-    delay(150);
-    reset();
-    delay(150);
-    
-    unsealed();
-    read_flash_block(48, 0);
-    int16_t updated_energy = flash_block_data[13] << 8;
-    updated_energy |= flash_block_data[14];
-    
-    if (energy != updated_energy) {
-        return false;
-    }
-    return true;
+    uint8_t key_2[2] = {0x72, 0x36};
+    unlocked = write_block(0x00, key_2, 2) == BQ34Z100G1_STATUS_OK; // Control
+}
+
+bool BQ34Z100G1::update_design_capacity(int16_t capacity) {
+    BQ34Z100G1_OPERATION(*this);
+    stage<DataFlash::CycleCount>(0);
+    stage<DataFlash::CCThreshold>(capacity);
+    stage<DataFlash::DesignCapacity>(capacity);
+    return commit_flash_update();
+}
+
+bool BQ34Z100G1::update_q_max(int16_t capacity) {
+    BQ34Z100G1_OPERATION(*this);
+    stage<DataFlash::QMax>(capacity);
+    stage<DataFlash::QMaxCycleCount>(0);
+    return commit_flash_update();
+}
+
+bool BQ34Z100G1::update_design_energy(int16_t energy) {
+    BQ34Z100G1_OPERATION(*this);
+    stage<DataFlash::DesignEnergy>(energy);
+    return commit_flash_update();
 }
 
 bool BQ34Z100G1::update_cell_charge_voltage_range(uint16_t t1_t2, uint16_t t2_t3, uint16_t t3_t4) {
-    unsealed();
-    read_flash_block(48, 0);
-    
-    flash_block_data[17] = t1_t2 >> 8; // Cell Charge Voltage T1-T2
-    flash_block_data[18] = t1_t2 & 0xff;
-    
-    flash_block_data[19] = t2_t3 >> 8; // Cell Charge Voltage T2-T3
-    flash_block_data[20] = t2_t3 & 0xff;
-    
-    flash_block_data[21] = t3_t4 >> 8; // Cell Charge Voltage T3-T4
-    flash_block_data[22] = t3_t4 & 0xff;
-    
-    for (uint8_t i = 17; i <= 22; i++) {
-        write_reg(0x40 + i, flash_block_data[i]);
-    }
-    
-    write_reg(0x60, flash_block_checksum());
-    
-    delay(150);
-    reset();
-    delay(150);
-    
-    unsealed();
-    read_flash_block(48, 0);
-    uint16_t updated_t1_t2 = flash_block_data[17] << 8;
-    updated_t1_t2 |= flash_block_data[18];
-    
-    uint16_t updated_t2_t3 = flash_block_data[19] << 8;
-    updated_t2_t3 |= flash_block_data[20];
-    
-    uint16_t updated_t3_t4 = flash_block_data[21] << 8;
-    updated_t3_t4 |= flash_block_data[22];
-    
-    if (t1_t2 != updated_t1_t2 || t2_t3 != updated_t2_t3 || t3_t4 != updated_t3_t4) {
-        return false;
-    }
-    return true;
+    BQ34Z100G1_OPERATION(*this);
+    stage<DataFlash::CellChargeVoltageT1T2>(t1_t2);
+    stage<DataFlash::CellChargeVoltageT2T3>(t2_t3);
+    stage<DataFlash::CellChargeVoltageT3T4>(t3_t4);
+    return commit_flash_update();
 }
 
 bool BQ34Z100G1::update_number_of_series_cells(uint8_t cells) {
-    unsealed();
-    read_flash_block(64, 0);
-    
-    flash_block_data[7] = cells; // Number of Series Cell
-    
-    write_reg(0x40 + 7, flash_block_data[7]);
-    
-    write_reg(0x60, flash_block_checksum());
-    
-    delay(150);
-    reset();
-    delay(150);
-    
-    unsealed();
-    read_flash_block(64, 0);
-    
-    if (cells != flash_block_data[7]) {
-        return false;
-    }
-    return true;
+    BQ34Z100G1_OPERATION(*this);
+    stage<DataFlash::NumberOfSeriesCells>(cells);
+    return commit_flash_update();
 }
 
 bool BQ34Z100G1::update_pack_configuration(uint16_t config) {
-    unsealed();
-    read_flash_block(64, 0);
-    
-    flash_block_data[0] = config >> 8; // Pack Configuration
-    flash_block_data[1] = config & 0xff;
-    
-    for (uint8_t i = 0; i <= 1; i++) {
-        write_reg(0x40 + i, flash_block_data[i]);
-    }
-    
-    write_reg(0x60, flash_block_checksum());
-    
-    delay(150);
-    reset();
-    delay(150);
-    
-    unsealed();
-    read_flash_block(64, 0);
-    uint16_t updated_config = flash_block_data[0] << 8;
-    updated_config |= flash_block_data[1];
-    if (config != updated_config) {
-        return false;
-    }
-    return true;
+    BQ34Z100G1_OPERATION(*this);
+    stage<DataFlash::PackConfiguration>(config);
+    return commit_flash_update();
+}
+
+bool BQ34Z100G1::update_alert_configuration(uint16_t flags) {
+    BQ34Z100G1_OPERATION(*this);
+    stage<DataFlash::AlertConfiguration>(flags);
+    return commit_flash_update();
 }
 
 bool BQ34Z100G1::update_charge_termination_parameters(int16_t taper_current, int16_t min_taper_capacity, int16_t cell_taper_voltage, uint8_t taper_window, int8_t tca_set, int8_t tca_clear, int8_t fc_set, int8_t fc_clear) {
-    unsealed();
-    read_flash_block(36, 0);
-    
-    flash_block_data[0] = taper_current >> 8; // Taper Current
-    flash_block_data[1] = taper_current & 0xff;
-    
-    flash_block_data[2] = min_taper_capacity >> 8; // Min Taper Capacity
-    flash_block_data[3] = min_taper_capacity & 0xff;
-    
-    flash_block_data[4] = cell_taper_voltage >> 8; // Cell Taper Voltage
-    flash_block_data[5] = cell_taper_voltage & 0xff;
-    
-    flash_block_data[6] = taper_window; // Current Taper Window
-    
-    flash_block_data[7] = tca_set & 0xff; // TCA Set %
-    
-    flash_block_data[8] = tca_clear & 0xff; // TCA Clear %
-    
-    flash_block_data[9] = fc_set & 0xff; // FC Set %
-    
-    flash_block_data[10] = fc_clear & 0xff; // FC Clear %
-    
-    for (uint8_t i = 0; i <= 10; i++) {
-        write_reg(0x40 + i, flash_block_data[i]);
+    BQ34Z100G1_OPERATION(*this);
+    stage<DataFlash::TaperCurrent>(taper_current);
+    stage<DataFlash::MinTaperCapacity>(min_taper_capacity);
+    stage<DataFlash::CellTaperVoltage>(cell_taper_voltage);
+    stage<DataFlash::CurrentTaperWindow>(taper_window);
+    stage<DataFlash::TCASet>(tca_set);
+    stage<DataFlash::TCAClear>(tca_clear);
+    stage<DataFlash::FCSet>(fc_set);
+    stage<DataFlash::FCClear>(fc_clear);
+    return commit_flash_update();
+}
+
+bool BQ34Z100G1::apply_profile(const PackProfile &profile) {
+    BQ34Z100G1_OPERATION(*this);
+    // Diff against the pack attached now: on a test station the cache may
+    // still hold the blocks of the previous one. Staged changes are kept.
+    for (uint8_t n = 0; n < BQ34Z100G1_FLASH_CACHE_BLOCKS; n++) {
+        if (!flash_cache[n].dirty && !flash_cache[n].written) {
+            flash_cache[n].valid = false;
+        }
     }
-    
-    write_reg(0x60, flash_block_checksum());
-    
-    delay(150);
-    reset();
-    delay(150);
-    
-    unsealed();
-    read_flash_block(36, 0);
-    int16_t updated_taper_current, updated_min_taper_capacity, updated_cell_taper_voltage;
-    uint8_t updated_taper_window;
-    int8_t updated_tca_set, updated_tca_clear, updated_fc_set, updated_fc_clear;
-    
-    updated_taper_current = flash_block_data[0] << 8;
-    updated_taper_current |= flash_block_data[1];
-    
-    updated_min_taper_capacity = flash_block_data[2] << 8;
-    updated_min_taper_capacity |= flash_block_data[3];
-    
-    updated_cell_taper_voltage = flash_block_data[4] << 8;
-    updated_cell_taper_voltage |= flash_block_data[5];
-    
-    updated_taper_window = flash_block_data[6];
-    
-    updated_tca_set = flash_block_data[7] & 0xff;
-    
-    updated_tca_clear = flash_block_data[8] & 0xff;
-    
-    updated_fc_set = flash_block_data[9] & 0xff;
-    
-    updated_fc_clear = flash_block_data[10] & 0xff;
-    
-    if (taper_current != updated_taper_current) {
-        return false;
+    begin_flash_update();
+    
+    stage<DataFlash::CycleCount>(0);
+    stage<DataFlash::CCThreshold>(profile.design_capacity);
+    stage<DataFlash::DesignCapacity>(profile.design_capacity);
+    stage<DataFlash::DesignEnergy>(profile.design_energy);
+    stage<DataFlash::CellChargeVoltageT1T2>(profile.cell_charge_voltage_t1_t2);
+    stage<DataFlash::CellChargeVoltageT2T3>(profile.cell_charge_voltage_t2_t3);
+    stage<DataFlash::CellChargeVoltageT3T4>(profile.cell_charge_voltage_t3_t4);
+    
+    stage<DataFlash::QMax>(profile.q_max);
+    stage<DataFlash::QMaxCycleCount>(0);
+    
+    stage<DataFlash::PackConfiguration>(profile.pack_configuration);
+    stage<DataFlash::NumberOfSeriesCells>(profile.series_cells);
+    
+    stage<DataFlash::TaperCurrent>(profile.taper_current);
+    stage<DataFlash::MinTaperCapacity>(profile.min_taper_capacity);
+    stage<DataFlash::CellTaperVoltage>(profile.cell_taper_voltage);
+    stage<DataFlash::CurrentTaperWindow>(profile.taper_window);
+    stage<DataFlash::TCASet>(profile.tca_set);
+    stage<DataFlash::TCAClear>(profile.tca_clear);
+    stage<DataFlash::FCSet>(profile.fc_set);
+    stage<DataFlash::FCClear>(profile.fc_clear);
+    
+    stage<DataFlash::Deadband>(profile.deadband);
+    
+    return end_flash_update();
+}
+
+bool BQ34Z100G1::calibrate_cc_offset(uint32_t timeout) {
+    BQ34Z100G1_OPERATION(*this);
+    Calibration calibration(*this, Calibration::CC_OFFSET, timeout);
+    return calibrate(calibration);
+}
+
+bool BQ34Z100G1::calibrate_board_offset(uint32_t timeout) {
+    BQ34Z100G1_OPERATION(*this);
+    Calibration calibration(*this, Calibration::BOARD_OFFSET, timeout);
+    return calibrate(calibration);
+}
+
+bool BQ34Z100G1::calibrate(Calibration &calibration) {
+    // Calibration takes seconds; the per call deadline is for bus transfers.
+    uint16_t deadline = operation_deadline;
+    operation_deadline = 0;
+    // Transfers refused while the gauge is busy are repeated by the state machine.
+    BQ34Z100G1Status status = operation_status;
+    calibration.start();
+    while (!calibration.done()) {
+        bus.delay(calibration.poll_interval);
+        calibration.poll();
     }
-    if (min_taper_capacity != updated_min_taper_capacity) {
+    operation_deadline = deadline;
+    operation_status = status;
+    if (calibration.result() != Calibration::OK) {
+        failed(BQ34Z100G1_STATUS_TIMEOUT);
         return false;
     }
-    if (cell_taper_voltage != updated_cell_taper_voltage) {
-        return false;
+    return true;
+}
+
+BQ34Z100G1::Calibration::Calibration(BQ34Z100G1 &gauge, Type type, uint32_t timeout) : poll_interval(100), retry_interval(1000), gauge(gauge), type(type), state(IDLE), outcome(PENDING), timeout(timeout), started(0), last_poll(0), last_command(0), resets(0) {
+}
+
+void BQ34Z100G1::Calibration::start() {
+    BQ34Z100G1_OPERATION(gauge);
+    started = gauge.bus.millis();
+    last_poll = started;
+    outcome = PENDING;
+    
+    gauge.unsealed();
+    gauge.cal_enable();
+    gauge.enter_cal();
+    last_command = started;
+    state = ENTERING;
+}
+
+void BQ34Z100G1::Calibration::command() {
+    switch (state) {
+        case ENTERING:
+            gauge.cal_enable();
+            gauge.enter_cal();
+            break;
+        case STARTING:
+            if (type == CC_OFFSET) {
+                gauge.cc_offset();
+            } else {
+                gauge.board_offset();
+            }
+            break;
+        case EXITING:
+            gauge.exit_cal();
+            break;
+        default:
+            break;
     }
-    if (taper_window != updated_taper_window) {
-        return false;
+    last_command = gauge.bus.millis();
+}
+
+void BQ34Z100G1::Calibration::finish(Result result) {
+    if (result != OK && state != IDLE && state != EXITING) {
+        gauge.exit_cal(); // Best effort, leave the gauge out of calibration mode
     }
-    if (tca_set != updated_tca_set) {
-        return false;
+    if (result != OK) {
+        gauge.failed(BQ34Z100G1_STATUS_TIMEOUT);
     }
-    if (tca_clear != updated_tca_clear) {
-        return false;
+    outcome = result;
+    state = IDLE;
+}
+
+void BQ34Z100G1::Calibration::poll() {
+    BQ34Z100G1_OPERATION(gauge);
+    if (state == IDLE) {
+        return;
     }
-    if (fc_set != updated_fc_set) {
-        return false;
+    uint32_t now = gauge.bus.millis();
+    if (now - last_poll < poll_interval) {
+        return;
     }
-    if (fc_clear != updated_fc_clear) {
-        return false;
+    last_poll = now;
+    
+    if (now - started > timeout) {
+        switch (state) {
+            case ENTERING: finish(ENTER_TIMEOUT); break;
+            case STARTING: finish(START_TIMEOUT); break;
+            case RUNNING: finish(RUN_TIMEOUT); break;
+            default: finish(EXIT_TIMEOUT); break;
+        }
+        return;
     }
-    return true;
-}
-
-void BQ34Z100G1::calibrate_cc_offset() {
-    enter_calibration();
-    do {
-        cc_offset();
-        delay(1000);
-    } while (!(control_status() & 0x0800)); // CCA
-    
-    do {
-        delay(1000);
-    } while (!(control_status() &~ 0x0800)); // CCA
     
-    cc_offset_save();
-    exit_calibration();
-}
-
-void BQ34Z100G1::calibrate_board_offset() {
-    enter_calibration();
-    do {
-        board_offset();
-        delay(1000);
-    } while (!(control_status() & 0x0c00)); // CCA + BCA
+    uint16_t mask = type == CC_OFFSET ? 0x0800 : 0x0c00; // CCA, CCA + BCA
+    uint16_t status = 0;
+    if (state != RESETTING) {
+        status = gauge.control_status();
+        if (gauge.transfer_status != BQ34Z100G1_STATUS_OK) {
+            return; // Unknown, look again next poll
+        }
+    }
     
-    do {
-        delay(1000);
-    } while (!(control_status() &~ 0x0c00)); // CCA + BCA
+    switch (state) {
+        case ENTERING:
+            if (status & 0x1000) { // CALEN
+                state = STARTING;
+                command();
+                return;
+            }
+            break;
+        case STARTING:
+            if (status & mask) {
+                state = RUNNING;
+                return;
+            }
+            break;
+        case RUNNING:
+            if (!(status & mask)) {
+                gauge.cc_offset_save();
+                state = EXITING;
+                command();
+            }
+            return;
+        case EXITING:
+            if (!(status & 0x1000)) { // CALEN
+                resets = gauge.reset_data();
+                gauge.reset();
+                state = RESETTING;
+                return;
+            }
+            break;
+        case RESETTING:
+            if (gauge.reset_data() == (uint16_t)(resets + 1) && gauge.transfer_status == BQ34Z100G1_STATUS_OK) {
+                finish(OK);
+            }
+            return;
+        default:
+            return;
+    }
     
-    cc_offset_save();
-    exit_calibration();
+    if (now - last_command >= retry_interval) {
+        command();
+    }
 }
 
-void BQ34Z100G1::calibrate_voltage_divider(uint16_t applied_voltage, uint8_t cells_count) {
-    double volt_array[50];
-    for (uint8_t i = 0; i < 50; i++) {
-        volt_array[i] = voltage();
-        delay(150);
+bool BQ34Z100G1::Calibration::done() const {
+    return outcome != PENDING;
+}
+
+BQ34Z100G1::Calibration::Result BQ34Z100G1::Calibration::result() const {
+    return outcome;
+}
+
+// Running mean and variance of integer samples, kept as sums of the offset
+// from the first sample so they stay small and need no floating point.
+class SampleStatistics {
+    int32_t reference;
+    uint16_t accepted;
+    uint16_t outlier_limit;
+    int32_t sum;
+    uint32_t sum_squares;
+    
+public:
+    SampleStatistics(uint16_t outlier_limit) : reference(0), accepted(0), outlier_limit(outlier_limit), sum(0), sum_squares(0) {}
+    
+    void add(int32_t sample) {
+        if (accepted == 0) {
+            reference = sample;
+        }
+        int32_t delta = sample - reference;
+        if (outlier_limit && accepted >= 4) {
+            int32_t deviation = delta - sum / accepted;
+            if (deviation > outlier_limit || deviation < -(int32_t)outlier_limit) {
+                return;
+            }
+        }
+        uint32_t magnitude = delta < 0 ? -delta : delta;
+        uint32_t square = magnitude * magnitude;
+        sum += delta;
+        sum_squares = sum_squares + square < sum_squares ? UINT32_MAX : sum_squares + square;
+        accepted++;
     }
-    double volt_mean = 0;
-    for (uint8_t i = 0; i < 50; i++) {
-        volt_mean += volt_array[i];
+    
+    uint16_t count() const {
+        return accepted;
     }
-    volt_mean /= 50.0;
     
-    double volt_sd = 0;
-    for (uint8_t i = 0; i < 50; i++) {
-        volt_sd += pow(volt_array[i] - volt_mean, 2);
+    float mean() const {
+        if (accepted == 0) {
+            return 0;
+        }
+        return reference + (float)sum / accepted;
     }
-    volt_sd /= 50.0;
-    volt_sd = sqrt(volt_sd);
     
-    if (volt_sd > 100) {
-        return;
+    uint32_t variance() const {
+        if (accepted == 0) {
+            return 0;
+        }
+        int32_t mean_delta = sum / accepted;
+        uint32_t magnitude = mean_delta < 0 ? -mean_delta : mean_delta;
+        uint32_t mean_square = sum_squares / accepted;
+        uint32_t square_mean = magnitude * magnitude;
+        return mean_square > square_mean ? mean_square - square_mean : 0;
     }
+};
 
-    unsealed();
-    read_flash_block(104, 0);
-    
-    uint16_t current_voltage_divider = flash_block_data[14] << 8;
-    current_voltage_divider |= flash_block_data[15];
-    
-    uint16_t new_voltage_divider = ((double)applied_voltage / volt_mean) * (double)current_voltage_divider;
-    
-    flash_block_data[14] = new_voltage_divider >> 8;
-    flash_block_data[15] = new_voltage_divider & 0xff;
-    
-    for (uint8_t i = 14; i <= 15; i++) {
-        write_reg(0x40 + i, flash_block_data[i]);
+void BQ34Z100G1::set_calibration_sampling(uint16_t samples, uint16_t interval, uint16_t outlier_limit) {
+    calibration_samples = samples ? samples : 1; // The calibrations divide by the count
+    calibration_sample_interval = interval;
+    calibration_outlier_limit = outlier_limit;
+}
+
+bool BQ34Z100G1::calibrate_voltage_divider(uint16_t applied_voltage, uint8_t cells_count) {
+    BQ34Z100G1_OPERATION(*this);
+    SampleStatistics volt(calibration_outlier_limit);
+    for (uint16_t i = 0; i < calibration_samples; i++) {
+        volt.add(voltage());
+        bus.delay(calibration_sample_interval);
     }
     
-    write_reg(0x60, flash_block_checksum());
-    delay(150);
+    if (volt.count() == 0 || volt.count() < calibration_samples / 2 || volt.variance() > 100UL * 100) { // SD above 100 mV
+        return false;
+    }
+    float volt_mean = volt.mean();
+
+    uint16_t current_voltage_divider = get<DataFlash::VoltageDivider>();
     
-    unsealed();
-    read_flash_block(68, 0);
+    uint16_t new_voltage_divider = ((double)applied_voltage / volt_mean) * (double)current_voltage_divider;
+    stage<DataFlash::VoltageDivider>(new_voltage_divider);
     
     int16_t flash_update_of_cell_voltage = (double)(2800 * cells_count * 5000) / (double)new_voltage_divider;
+    stage<DataFlash::FlashUpdateOKCellVolt>(flash_update_of_cell_voltage);
     
-    flash_block_data[0] = flash_update_of_cell_voltage << 8;
-    flash_block_data[1] = flash_update_of_cell_voltage & 0xff;
-    
-    for (uint8_t i = 0; i <= 1; i++) {
-        write_reg(0x40 + i, flash_block_data[i]);
-    }
-    
-    write_reg(0x60, flash_block_checksum());
-    
-    delay(150);
-    reset();
-    delay(150);
+    return commit_flash_update();
 }
 
-void BQ34Z100G1::calibrate_sense_resistor(int16_t applied_current) {
-    double current_array[50];
-    for (uint8_t i = 0; i < 50; i++) {
-        current_array[i] = current();
-        delay(150);
+bool BQ34Z100G1::calibrate_sense_resistor(int16_t applied_current) {
+    BQ34Z100G1_OPERATION(*this);
+    SampleStatistics current_samples(calibration_outlier_limit);
+    for (uint16_t i = 0; i < calibration_samples; i++) {
+        current_samples.add(current());
+        bus.delay(calibration_sample_interval);
     }
-    double current_mean = 0;
-    for (uint8_t i = 0; i < 50; i++) {
-        current_mean += current_array[i];
-    }
-    current_mean /= 50.0;
 
-    double current_sd = 0;
-    for (uint8_t i = 0; i < 50; i++) {
-        current_sd += pow(current_array[i] - current_mean, 2);
+    if (current_samples.count() == 0 || current_samples.count() < calibration_samples / 2 || current_samples.variance() > 100UL * 100) { // SD above 100 mA
+        return false;
     }
-    current_sd /= 50.0;
-    current_sd = sqrt(current_sd);
+    float current_mean = current_samples.mean();
 
-    if (current_sd > 100) {
-        return;
-    }
-
-    unsealed();
-    read_flash_block(104, 0);
-
-    uint32_t cc_gain = flash_block_data[0] << 24;
-    cc_gain |= flash_block_data[1] << 16;
-    cc_gain |= flash_block_data[2] << 8;
-    cc_gain |= flash_block_data[3];
-    
-    double gain_resistence = 4.768 / xemics_to_double(cc_gain);
+    double gain_resistence = 4.768 / xemics_to_double(get<DataFlash::CCGain>());
 
     double temp = (current_mean * gain_resistence) / (double)applied_current;
 
-    uint32_t new_cc_gain = double_to_xemics(4.768 / temp);
-    flash_block_data[0] = new_cc_gain >> 24;
-    flash_block_data[1] = new_cc_gain >> 16;
-    flash_block_data[2] = new_cc_gain >> 8;
-    flash_block_data[3] = new_cc_gain & 0xff;
+    stage<DataFlash::CCGain>(double_to_xemics(4.768 / temp));
+    stage<DataFlash::CCDelta>(double_to_xemics(5677445.6 / temp));
 
-    new_cc_gain = double_to_xemics(5677445.6 / temp);
-    flash_block_data[4] = new_cc_gain >> 24;
-    flash_block_data[5] = new_cc_gain >> 16;
-    flash_block_data[6] = new_cc_gain >> 8;
-    flash_block_data[7] = new_cc_gain & 0xff;
-    
-
-    for (uint8_t i = 0; i <= 3; i++) {
-        write_reg(0x40 + i, flash_block_data[i]);
-    }
-
-    for (uint8_t i = 4; i <= 7; i++) {
-        write_reg(0x40 + i, flash_block_data[i]);
-    }
-
-    write_reg(0x60, flash_block_checksum());
-    delay(150);
-    reset();
-    delay(150);
+    return commit_flash_update();
 }
 
 void BQ34Z100G1::set_current_deadband(uint8_t deadband) {
+    BQ34Z100G1_OPERATION(*this);
+    stage<DataFlash::Deadband>(deadband);
+    commit_flash_update();
+}
+
+void BQ34Z100G1::ready() {
+    BQ34Z100G1_OPERATION(*this);
     unsealed();
-    read_flash_block(107, 0);
+    it_enable();
+    sealed();
+}
+
+bool BQ34Z100G1::snapshot(Snapshot &data) {
+    BQ34Z100G1_OPERATION(*this);
+    read_block(0x02, (uint8_t *)&data, sizeof(data));
     
-    flash_block_data[1] = deadband;
+    // Voltage through Flags B changes on every gauge update, re-read to detect one.
+    uint8_t check[0x14 - 0x08];
+    read_block(0x08, check, sizeof(check));
+    return memcmp(check, &data.voltage, sizeof(check)) == 0 && operation_status == BQ34Z100G1_STATUS_OK;
+}
+
+bool BQ34Z100G1::snapshot(Snapshot &data, ExtendedSnapshot &extended) {
+    BQ34Z100G1_OPERATION(*this);
+    read_block(0x02, (uint8_t *)&data, sizeof(data));
+    read_block(0x62, (uint8_t *)&extended, sizeof(extended));
     
-    write_reg(0x40 + 1, flash_block_data[1]);
+    uint8_t check[0x14 - 0x08];
+    read_block(0x08, check, sizeof(check));
+    return memcmp(check, &data.voltage, sizeof(check)) == 0 && operation_status == BQ34Z100G1_STATUS_OK;
+}
+
+const BQ34Z100G1::Identity &BQ34Z100G1::identity() {
+    BQ34Z100G1_OPERATION(*this);
+    uint32_t now = bus.millis();
+    if (identity_valid && (identity_ttl == 0 || now - identity_time < identity_ttl)) {
+        return cached_identity;
+    }
+    cached_identity.device_type = read_control(0x01, 0x00);
+    cached_identity.fw_version = read_control(0x02, 0x00);
+    cached_identity.hw_version = read_control(0x03, 0x00);
+    cached_identity.chem_id = read_control(0x08, 0x00);
+    cached_identity.df_version = read_control(0x0c, 0x00);
     
-    write_reg(0x60, flash_block_checksum());
+    BQ34Z100G1Burst<SerialNumber, PackConfiguration, DesignCapacity> burst;
+    read(burst);
+    cached_identity.serial_number = burst.get<SerialNumber>();
+    cached_identity.pack_configuration = burst.get<PackConfiguration>();
+    cached_identity.design_capacity = burst.get<DesignCapacity>();
     
-    delay(150);
-    reset();
-    delay(150);
+    identity_valid = operation_status == BQ34Z100G1_STATUS_OK; // Never cache a failed read
+    identity_time = now;
+    return cached_identity;
 }
 
-void BQ34Z100G1::ready() {
-    unsealed();
-    it_enable();
-    sealed();
+void BQ34Z100G1::set_identity_ttl(uint32_t ttl) {
+    identity_ttl = ttl;
+}
+
+void BQ34Z100G1::invalidate_identity() {
+    identity_valid = false;
 }
 
 uint16_t BQ34Z100G1::control_status() {
+    BQ34Z100G1_OPERATION(*this);
     return read_control(0x00, 0x00);
 }
 
 uint16_t BQ34Z100G1::device_type() {
-    return read_control(0x01, 0x00);
+    BQ34Z100G1_OPERATION(*this);
+    return identity().device_type;
 }
 
 uint16_t BQ34Z100G1::fw_version() {
-    return read_control(0x02, 0x00);
+    BQ34Z100G1_OPERATION(*this);
+    return identity().fw_version;
 }
 
 uint16_t BQ34Z100G1::hw_version() {
-    return read_control(0x03, 0x00);
+    BQ34Z100G1_OPERATION(*this);
+    return identity().hw_version;
 }
 
 uint16_t BQ34Z100G1::reset_data() {
+    BQ34Z100G1_OPERATION(*this);
     return read_control(0x05, 0x00);
 }
 
 uint16_t BQ34Z100G1::prev_macwrite() {
+    BQ34Z100G1_OPERATION(*this);
     return read_control(0x07, 0x00);
 }
 
 uint16_t BQ34Z100G1::chem_id() {
-    return read_control(0x08, 0x00);
+    BQ34Z100G1_OPERATION(*this);
+    return identity().chem_id;
 }
 
 uint16_t BQ34Z100G1::board_offset() {
+    BQ34Z100G1_OPERATION(*this);
     return read_control(0x09, 0x00);
 }
 
 uint16_t BQ34Z100G1::cc_offset() {
+    BQ34Z100G1_OPERATION(*this);
     return read_control(0x0a, 0x00);
 }
 
 uint16_t BQ34Z100G1::cc_offset_save() {
+    BQ34Z100G1_OPERATION(*this);
     return read_control(0x0b, 0x00);
 }
 
 uint16_t BQ34Z100G1::df_version() {
-    return read_control(0x0c, 0x00);
+    BQ34Z100G1_OPERATION(*this);
+    return identity().df_version;
 }
 
 uint16_t BQ34Z100G1::set_fullsleep() {
+    BQ34Z100G1_OPERATION(*this);
     return read_control(0x10, 0x00);
 }
 
 uint16_t BQ34Z100G1::static_chem_chksum() {
+    BQ34Z100G1_OPERATION(*this);
     return read_control(0x17, 0x00);
 }
 
 uint16_t BQ34Z100G1::sealed() {
+    BQ34Z100G1_OPERATION(*this);
+    invalidate_flash_cache();
     return read_control(0x20, 0x00);
 }
 
 uint16_t BQ34Z100G1::it_enable() {
+    BQ34Z100G1_OPERATION(*this);
     return read_control(0x21, 0x00);
 }
 
 uint16_t BQ34Z100G1::cal_enable() {
+    BQ34Z100G1_OPERATION(*this);
     return read_control(0x2d, 0x00);
 }
 
 uint16_t BQ34Z100G1::reset() {
+    BQ34Z100G1_OPERATION(*this);
+    invalidate_flash_cache();
+    invalidate_identity();
     return read_control(0x41, 0x00);
 }
 
 uint16_t BQ34Z100G1::exit_cal() {
+    BQ34Z100G1_OPERATION(*this);
     return read_control(0x80, 0x00);
 }
 
 uint16_t BQ34Z100G1::enter_cal() {
+    BQ34Z100G1_OPERATION(*this);
     return read_control(0x81, 0x00);
 }
 
 uint16_t BQ34Z100G1::offset_cal() {
+    BQ34Z100G1_OPERATION(*this);
     return read_control(0x82, 0x00);
 }
 
 uint8_t BQ34Z100G1::state_of_charge() {
-    return (uint8_t)read_register(0x02, 1);
+    BQ34Z100G1_OPERATION(*this);
+    return read<StateOfCharge>();
 }
 
 uint8_t BQ34Z100G1::state_of_charge_max_error() {
-    return (uint8_t)read_register(0x03, 1);
+    BQ34Z100G1_OPERATION(*this);
+    return read<StateOfChargeMaxError>();
 }
 
 uint16_t BQ34Z100G1::remaining_capacity() {
-    return read_register(0x04, 2);
+    BQ34Z100G1_OPERATION(*this);
+    return read<RemainingCapacity>();
 }
 
 uint16_t BQ34Z100G1::full_charge_capacity() {
-    return read_register(0x06, 2);
+    BQ34Z100G1_OPERATION(*this);
+    return read<FullChargeCapacity>();
 }
 
 uint16_t BQ34Z100G1::voltage() {
-    return read_register(0x08, 2);
+    BQ34Z100G1_OPERATION(*this);
+    return read<Voltage>();
 }
 
 int16_t BQ34Z100G1::average_current() {
-    return (int16_t)read_register(0x0a, 2);
+    BQ34Z100G1_OPERATION(*this);
+    return read<AverageCurrent>();
 }
 
 uint16_t BQ34Z100G1::temperature() {
-    return read_register(0x0c, 2);
+    BQ34Z100G1_OPERATION(*this);
+    return read<Temperature>();
 }
 
 uint16_t BQ34Z100G1::flags() {
-    return read_register(0x0e, 2);
+    BQ34Z100G1_OPERATION(*this);
+    return read<Flags>();
 }
 
 uint16_t BQ34Z100G1::flags_b() {
-    return read_register(0x12, 2);
+    BQ34Z100G1_OPERATION(*this);
+    return read<FlagsB>();
 }
 
 int16_t BQ34Z100G1::current() {
-    return (int16_t)read_register(0x10, 2);
+    BQ34Z100G1_OPERATION(*this);
+    return read<Current>();
 }
 
 uint16_t BQ34Z100G1::average_time_to_empty() {
-    return read_register(0x18, 2);
+    BQ34Z100G1_OPERATION(*this);
+    return read<AverageTimeToEmpty>();
 }
 
 uint16_t BQ34Z100G1::average_time_to_full() {
-    return read_register(0x1a, 2);
+    BQ34Z100G1_OPERATION(*this);
+    return read<AverageTimeToFull>();
 }
 
 int16_t BQ34Z100G1::passed_charge() {
-    return read_register(0x1c, 2);
+    BQ34Z100G1_OPERATION(*this);
+    return read<PassedCharge>();
 }
 
 uint16_t BQ34Z100G1::do_d0_time() {
-    return read_register(0x1e, 2);
+    BQ34Z100G1_OPERATION(*this);
+    return read<DoD0Time>();
 }
 
 uint16_t BQ34Z100G1::available_energy() {
-    return read_register(0x24, 2);
+    BQ34Z100G1_OPERATION(*this);
+    return read<AvailableEnergy>();
 }
 
-uint16_t BQ34Z100G1::average_power() {
-    return read_register(0x26, 2);
+int16_t BQ34Z100G1::average_power() {
+    BQ34Z100G1_OPERATION(*this);
+    return read<AveragePower>();
 }
 
 uint16_t BQ34Z100G1::serial_number() {
-    return read_register(0x28, 2);
+    BQ34Z100G1_OPERATION(*this);
+    return identity().serial_number;
 }
 
 uint16_t BQ34Z100G1::internal_temperature() {
-    return read_register(0x2a, 2);
+    BQ34Z100G1_OPERATION(*this);
+    return read<InternalTemperature>();
 }
 
 uint16_t BQ34Z100G1::cycle_count() {
-    return read_register(0x2c, 2);
+    BQ34Z100G1_OPERATION(*this);
+    return read<CycleCount>();
 }
 
 uint16_t BQ34Z100G1::state_of_health() {
-    return read_register(0x2e, 2);
+    BQ34Z100G1_OPERATION(*this);
+    return read<StateOfHealth>();
 }
 
 uint16_t BQ34Z100G1::charge_voltage() {
-    return read_register(0x30, 2);
+    BQ34Z100G1_OPERATION(*this);
+    return read<ChargeVoltage>();
 }
 
 uint16_t BQ34Z100G1::charge_current() {
-    return read_register(0x32, 2);
+    BQ34Z100G1_OPERATION(*this);
+    return read<ChargeCurrent>();
 }
 
 uint16_t BQ34Z100G1::pack_configuration() {
-    return read_register(0x3a, 2);
+    BQ34Z100G1_OPERATION(*this);
+    return identity().pack_configuration;
 }
 
 uint16_t BQ34Z100G1::design_capacity() {
-    return read_register(0x3c, 2);
+    BQ34Z100G1_OPERATION(*this);
+    return identity().design_capacity;
 }
 
 uint8_t BQ34Z100G1::grid_number() {
-    return (uint8_t)read_register(0x62, 1);
+    BQ34Z100G1_OPERATION(*this);
+    return read<GridNumber>();
 }
 
 uint8_t BQ34Z100G1::learned_status() {
-    return (uint8_t)read_register(0x63, 1);
+    BQ34Z100G1_OPERATION(*this);
+    return read<LearnedStatus>();
 }
 
 uint16_t BQ34Z100G1::dod_at_eoc() {
-    return read_register(0x64, 2);
+    BQ34Z100G1_OPERATION(*this);
+    return read<DoDAtEoC>();
 }
 
 uint16_t BQ34Z100G1::q_start() {
-    return read_register(0x66, 2);
+    BQ34Z100G1_OPERATION(*this);
+    return read<QStart>();
 }
 
 uint16_t BQ34Z100G1::true_fcc() {
-    return read_register(0x6a, 2);
+    BQ34Z100G1_OPERATION(*this);
+    return read<TrueFCC>();
 }
 
 uint16_t BQ34Z100G1::state_time() {
-    return read_register(0x6c, 2);
+    BQ34Z100G1_OPERATION(*this);
+    return read<StateTime>();
 }
 
 uint16_t BQ34Z100G1::q_max_passed_q() {
-    return read_register(0x6e, 2);
+    BQ34Z100G1_OPERATION(*this);
+    return read<QMaxPassedQ>();
 }
 
 uint16_t BQ34Z100G1::dod_0() {
-    return read_register(0x70, 2);
+    BQ34Z100G1_OPERATION(*this);
+    return read<DoD0>();
 }
 
 uint16_t BQ34Z100G1::q_max_dod_0() {
-    return read_register(0x72, 2);
+    BQ34Z100G1_OPERATION(*this);
+    return read<QMaxDoD0>();
 }
 
 uint16_t BQ34Z100G1::q_max_time() {
-    return read_register(0x74, 2);
+    BQ34Z100G1_OPERATION(*this);
+    return read<QMaxTime>();
 }
@@ -9,8 +9,54 @@
 #ifndef bq34z100g1_hpp
 #define bq34z100g1_hpp
 
-#include <Arduino.h>
-#include <Wire.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bq34z100g1_registers.hpp"
+#include "bq34z100g1_status.hpp"
+
+#if defined(BQ34Z100G1_BUS_HEADER)
+#include BQ34Z100G1_BUS_HEADER
+#elif defined(ARDUINO) || !defined(__linux__)
+#include "bq34z100g1_wire.hpp"
+#define BQ34Z100G1_BUS BQ34Z100G1WireBus
+#else
+#include "bq34z100g1_linux.hpp"
+#define BQ34Z100G1_BUS BQ34Z100G1LinuxBus
+#endif
+
+#ifdef BQ34Z100G1_STATS
+#include "bq34z100g1_stats.hpp"
+#define BQ34Z100G1_STATS_SCOPE(bus) BQ34Z100G1StatsBus<BQ34Z100G1_BUS>::Scope stats_scope(bus, __func__)
+#else
+#define BQ34Z100G1_STATS_SCOPE(bus)
+#endif
+
+// Opens a call to the gauge for last_status(), the deadline and statistics.
+#define BQ34Z100G1_OPERATION(gauge) BQ34Z100G1::Operation operation(gauge); BQ34Z100G1_STATS_SCOPE((gauge).bus)
+
+const uint8_t BQ34Z100_G1_ADDRESS = 0x55;
+
+// Xemics floats (CC Gain, CC Delta) hold the same 24 bit mantissa as an
+// IEEE 754 single, with the sign in bit 23 and the exponent bias raised by 2.
+// Zero and values too small for the gauge map to 0, larger ones saturate.
+constexpr uint32_t ieee754_to_xemics(uint32_t bits) {
+    return ((bits >> 23) & 0xff) == 0 ? 0
+         : ((bits >> 23) & 0xff) >= 254 ? 0xff000000UL | ((bits >> 8) & 0x800000UL) | 0x7fffffUL
+         : ((((bits >> 23) & 0xff) + 2) << 24) | ((bits >> 8) & 0x800000UL) | (bits & 0x7fffffUL);
+}
+
+constexpr uint32_t xemics_to_ieee754(uint32_t value) {
+    return (value >> 24) <= 2 ? 0
+         : ((value & 0x800000UL) << 8) | (((value >> 24) - 2) << 23) | (value & 0x7fffffUL);
+}
+
+static_assert(ieee754_to_xemics(0x3f800000UL) == 0x81000000UL, "1.0");
+static_assert(xemics_to_ieee754(0x81800000UL) == 0xbf800000UL, "-1.0");
+
+#ifndef BQ34Z100G1_FLASH_CACHE_BLOCKS
+#define BQ34Z100G1_FLASH_CACHE_BLOCKS 5 // 48 bytes of RAM each, 5 holds a full PackProfile
+#endif
 
 /*
  1. Update design capacity.
@@ -29,39 +75,352 @@
  */
 
 class BQ34Z100G1 {
-    uint8_t flash_block_data[32];
+    friend class BQ34Z100G1Log;
+    friend class BQ34Z100G1FlashImage;
+    friend class BQ34Z100G1Publisher;
+    friend class BQ34Z100G1FlashStream;
+    friend class BQ34Z100G1Alert;
+    
+#ifdef BQ34Z100G1_STATS
+    BQ34Z100G1StatsBus<BQ34Z100G1_BUS> bus;
+#else
+    BQ34Z100G1_BUS bus;
+#endif
+    uint8_t device;
     
+    struct FlashBlock {
+        uint8_t sub_class;
+        uint8_t block;
+        bool valid;
+        uint8_t age;
+        uint32_t dirty; // Bytes changed and not yet written, one bit per byte
+        uint32_t written; // Bytes written and not yet verified
+        uint32_t operation; // Call that fetched it
+        uint8_t data[32];
+    };
+    FlashBlock flash_cache[BQ34Z100G1_FLASH_CACHE_BLOCKS];
+    FlashBlock *flash_block; // Block selected by the last read_flash_block()
+    uint8_t flash_cache_age;
+    bool flash_batch;
+    bool flash_cache_overflow;
+    bool flash_update_rejected; // A staged value was out of range
+    bool unlocked; // Unseal keys sent since the last reset() or sealed()
+    
+    uint16_t completion_poll_interval; // ms
+    uint16_t completion_timeout; // ms
+    uint16_t last_flash_write_time; // ms
+    uint16_t last_reset_time; // ms
+    
+    uint16_t calibration_samples;
+    uint16_t calibration_sample_interval; // ms
+    uint16_t calibration_outlier_limit; // mV or mA, 0 keeps every sample
+    
+public:
+    struct Identity {
+        uint16_t device_type;
+        uint16_t fw_version;
+        uint16_t hw_version;
+        uint16_t chem_id;
+        uint16_t df_version;
+        uint16_t serial_number;
+        uint16_t pack_configuration;
+        uint16_t design_capacity; // mAh
+    };
+    
+private:
+    Identity cached_identity;
+    bool identity_valid;
+    uint32_t identity_time;
+    uint32_t identity_ttl; // ms, 0 never expires
+    
+    uint8_t retry_limit;
+    uint16_t operation_deadline; // ms, 0 for none
+    uint32_t operation_start;
+    bool operation_open;
+    uint32_t operation_count; // Outermost calls so far
+    BQ34Z100G1Status operation_status; // First failure of the current call
+    BQ34Z100G1Status transfer_status; // Last transfer, after retries
+    
+    // Scope of one public call; nested calls belong to the outermost one.
+    class Operation {
+        BQ34Z100G1 &gauge;
+        bool outer;
+        
+    public:
+        Operation(BQ34Z100G1 &gauge);
+        ~Operation();
+    };
+    
+    bool expired();
+    BQ34Z100G1Status failed(BQ34Z100G1Status status);
+    BQ34Z100G1Status read_block(uint8_t address, uint8_t *data, uint8_t length);
     uint16_t read_register(uint8_t address, uint8_t length);
     uint16_t read_control(uint8_t address_lsb, uint8_t address_msb);
     void read_flash_block(uint8_t sub_class, uint8_t offset);
+    void fetch_flash_block(FlashBlock &entry);
     void write_reg(uint8_t address, uint8_t value);
-    void write_flash_block(uint8_t sub_class, uint8_t offset);
+    BQ34Z100G1Status write_block(uint8_t address, const uint8_t *data, uint8_t length);
     
-    uint8_t flash_block_checksum();
+    uint8_t flash_block_checksum(const uint8_t *data);
+    void set_flash_byte(uint8_t offset, uint8_t value);
+    bool flush_flash_block(FlashBlock &entry);
+    void flush_flash_blocks();
+    bool verify_flash_blocks();
+    bool commit_flash_update();
+    void discard_flash_update();
+    bool wait_flash_write(uint8_t checksum);
+    bool reset_and_wait();
     
     double xemics_to_double(uint32_t value);
     uint32_t double_to_xemics(double value);
     
     void unsealed();
-    void enter_calibration();
-    void exit_calibration();
+    
+    template <class Parameter>
+    void stage(typename Parameter::type value) {
+        if (!Parameter::valid(value)) {
+            flash_update_rejected = true;
+            return;
+        }
+        uint8_t data[Parameter::length];
+        Parameter::encode(value, data);
+        read_flash_block(Parameter::sub_class, Parameter::offset);
+        if (!flash_block->valid) {
+            flash_update_rejected = true; // Patching unread data would corrupt the block
+            return;
+        }
+        for (uint8_t i = 0; i < Parameter::length; i++) {
+            set_flash_byte(Parameter::offset % 32 + i, data[i]);
+        }
+    }
     
 public:
     
+    BQ34Z100G1(const BQ34Z100G1_BUS &bus = BQ34Z100G1_BUS(), uint8_t device = BQ34Z100_G1_ADDRESS);
+    
+    // Standard commands 0x02 to 0x3d, laid out as on the gauge (little endian).
+    struct Snapshot {
+        uint8_t state_of_charge; // 0 to 100%
+        uint8_t state_of_charge_max_error; // 1 to 100%
+        uint16_t remaining_capacity; // mAh
+        uint16_t full_charge_capacity; // mAh
+        uint16_t voltage; // mV
+        int16_t average_current; // mA
+        uint16_t temperature; // Unit of x10 K
+        uint16_t flags;
+        int16_t current; // mA
+        uint16_t flags_b;
+        uint8_t reserved_0x14[4];
+        uint16_t average_time_to_empty; // Minutes
+        uint16_t average_time_to_full; // Minutes
+        int16_t passed_charge; // mAh
+        uint16_t do_d0_time; // Minutes
+        uint8_t reserved_0x20[4];
+        uint16_t available_energy; // 10 mWh
+        int16_t average_power; // 10 mW, negative while discharging
+        uint16_t serial_number;
+        uint16_t internal_temperature; // Unit of x10 K
+        uint16_t cycle_count; // Counts
+        uint16_t state_of_health; // 0 to 100%
+        uint16_t charge_voltage; // mV
+        uint16_t charge_current; // mA
+        uint8_t reserved_0x34[6];
+        uint16_t pack_configuration;
+        uint16_t design_capacity; // mAh
+    } __attribute__((packed));
+    
+    // Extended commands 0x62 to 0x75.
+    struct ExtendedSnapshot {
+        uint8_t grid_number;
+        uint8_t learned_status;
+        uint16_t dod_at_eoc;
+        uint16_t q_start; // mAh
+        uint16_t true_rc; // mAh
+        uint16_t true_fcc; // mAh
+        uint16_t state_time; // s
+        uint16_t q_max_passed_q; // mAh
+        uint16_t dod_0;
+        uint16_t q_max_dod_0;
+        uint16_t q_max_time;
+    } __attribute__((packed));
+    
+    // Burst reads, returns false if a read failed or the gauge updated its
+    // registers mid-read.
+    bool snapshot(Snapshot &data);
+    bool snapshot(Snapshot &data, ExtendedSnapshot &extended);
+    
+    // Data flash blocks are cached until reset(), except subclasses 48, 59,
+    // 60 and 82 to 84 (cycle count, Lifetime, Qmax, Update Status, Ra tables),
+    // which the gauge updates itself and each call reads again unless they
+    // hold staged changes. Between begin_flash_update()
+    // and end_flash_update() the update_* and set_* calls only patch the cache,
+    // end_flash_update() writes each changed block once, resets and verifies.
+    // invalidate_flash_cache() also sends the unseal keys again on next use.
+    void begin_flash_update();
+    bool end_flash_update();
+    void invalidate_flash_cache();
+    
+    // Data flash writes and resets complete when the block checksum reads
+    // back and RESET_DATA increments, checked every interval ms until timeout.
+    void set_completion_polling(uint16_t interval, uint16_t timeout);
+    uint16_t flash_write_time(); // ms taken by the last block write
+    uint16_t reset_time(); // ms taken by the last reset
+    
+#ifdef BQ34Z100G1_STATS
+    BQ34Z100G1Stats &stats() { return bus.stats; }
+#endif
+    
+    // Each transfer is tried up to 1 + retries times, recovering the bus
+    // after a timeout. Once deadline ms have passed since a call began, its
+    // remaining transfers and waits fail with BQ34Z100G1_STATUS_TIMEOUT.
+    // Defaults are 2 retries and no deadline. Failed reads return 0.
+    void set_retry_policy(uint8_t retries, uint16_t deadline);
+    BQ34Z100G1Status last_status(); // First failure of the last call, if any
+    
+    // Data flash parameters, read with get<>() and written with set<>().
+    // Parameters sharing a block share one fetch and, inside a batch, one write.
+    struct DataFlash {
+        typedef BQ34Z100G1Parameter<48, 6, uint16_t, 0, 65535> CycleCount;
+        typedef BQ34Z100G1Parameter<48, 8, int16_t, 0, 32767> CCThreshold; // mAh
+        typedef BQ34Z100G1Parameter<48, 11, int16_t, 0, 32767> DesignCapacity; // mAh
+        typedef BQ34Z100G1Parameter<48, 13, int16_t, 0, 32767> DesignEnergy; // mWh
+        typedef BQ34Z100G1Parameter<48, 17, uint16_t, 0, 5000> CellChargeVoltageT1T2; // mV
+        typedef BQ34Z100G1Parameter<48, 19, uint16_t, 0, 5000> CellChargeVoltageT2T3; // mV
+        typedef BQ34Z100G1Parameter<48, 21, uint16_t, 0, 5000> CellChargeVoltageT3T4; // mV
+        typedef BQ34Z100G1Parameter<82, 0, int16_t, 0, 32767> QMax; // mAh
+        typedef BQ34Z100G1Parameter<82, 2, uint16_t, 0, 65535> QMaxCycleCount;
+        typedef BQ34Z100G1Parameter<64, 0, uint16_t, 0, 65535> PackConfiguration;
+        typedef BQ34Z100G1Parameter<64, 5, uint16_t, 0, 65535> AlertConfiguration;
+        typedef BQ34Z100G1Parameter<64, 7, uint8_t, 1, 100> NumberOfSeriesCells;
+        typedef BQ34Z100G1Parameter<36, 0, int16_t, 0, 1000> TaperCurrent; // mA
+        typedef BQ34Z100G1Parameter<36, 2, int16_t, 0, 1000> MinTaperCapacity; // mAh
+        typedef BQ34Z100G1Parameter<36, 4, int16_t, 0, 1000> CellTaperVoltage; // mV
+        typedef BQ34Z100G1Parameter<36, 6, uint8_t, 0, 60> CurrentTaperWindow; // s
+        typedef BQ34Z100G1Parameter<36, 7, int8_t, -1, 100> TCASet; // %
+        typedef BQ34Z100G1Parameter<36, 8, int8_t, -1, 100> TCAClear; // %
+        typedef BQ34Z100G1Parameter<36, 9, int8_t, -1, 100> FCSet; // %
+        typedef BQ34Z100G1Parameter<36, 10, int8_t, -1, 100> FCClear; // %
+        typedef BQ34Z100G1Parameter<68, 0, int16_t, 0, 4200> FlashUpdateOKCellVolt; // mV
+        typedef BQ34Z100G1Parameter<104, 0, uint32_t, 0, 0> CCGain; // Xemics float
+        typedef BQ34Z100G1Parameter<104, 4, uint32_t, 0, 0> CCDelta; // Xemics float
+        typedef BQ34Z100G1Parameter<104, 14, uint16_t, 0, 65535> VoltageDivider; // mV
+        typedef BQ34Z100G1Parameter<107, 1, uint8_t, 0, 255> Deadband; // mA
+    };
+    
+    template <class Parameter>
+    typename Parameter::type get() {
+        BQ34Z100G1_OPERATION(*this);
+        read_flash_block(Parameter::sub_class, Parameter::offset);
+        return Parameter::decode(flash_block->data + Parameter::offset % 32);
+    }
+    
+    // Returns false without writing anything if value is out of range.
+    template <class Parameter>
+    bool set(typename Parameter::type value) {
+        BQ34Z100G1_OPERATION(*this);
+        stage<Parameter>(value);
+        return commit_flash_update();
+    }
+    
     bool update_design_capacity(int16_t capacity);
     bool update_q_max(int16_t capacity);
     bool update_design_energy(int16_t energy);
     bool update_cell_charge_voltage_range(uint16_t t1_t2, uint16_t t2_t3, uint16_t t3_t4);
     bool update_number_of_series_cells(uint8_t cells);
     bool update_pack_configuration(uint16_t config);
+    bool update_alert_configuration(uint16_t flags); // BQ34Z100G1Flag bits that assert ALERT
     bool update_charge_termination_parameters(int16_t taper_current, int16_t min_taper_capacity, int16_t cell_taper_voltage, uint8_t taper_window, int8_t tca_set, int8_t tca_clear, int8_t fc_set, int8_t fc_clear);
-    void calibrate_cc_offset();
-    void calibrate_board_offset();
-    void calibrate_voltage_divider(uint16_t applied_voltage, uint8_t cells_count);
-    void calibrate_sense_resistor(int16_t applied_current);
+    
+    // Steps 1 to 7 and 12 of the bring-up in one pass.
+    struct PackProfile {
+        int16_t design_capacity; // mAh
+        int16_t q_max; // mAh
+        int16_t design_energy; // mWh, scaled by the pack configuration
+        uint16_t cell_charge_voltage_t1_t2; // mV
+        uint16_t cell_charge_voltage_t2_t3; // mV
+        uint16_t cell_charge_voltage_t3_t4; // mV
+        uint8_t series_cells;
+        uint16_t pack_configuration;
+        int16_t taper_current; // mA
+        int16_t min_taper_capacity; // mAh
+        int16_t cell_taper_voltage; // mV
+        uint8_t taper_window; // s
+        int8_t tca_set; // %
+        int8_t tca_clear; // %
+        int8_t fc_set; // %
+        int8_t fc_clear; // %
+        uint8_t deadband; // mA
+    };
+    
+    // Reads the blocks it touches again, writes only the bytes that differ
+    // from the gauge, resets once and verifies them. Does not touch the gauge
+    // if nothing differs.
+    bool apply_profile(const PackProfile &profile);
+    // Blocking, see Calibration to run them from a main loop. The timeout
+    // covers the whole calibration; the retry policy deadline does not apply.
+    // False and BQ34Z100G1_STATUS_TIMEOUT if it did not finish.
+    bool calibrate_cc_offset(uint32_t timeout = 60000); // ms
+    bool calibrate_board_offset(uint32_t timeout = 60000); // ms
+    // Voltage divider and sense resistor calibration average samples readings
+    // taken interval ms apart, ignoring readings further than outlier_limit
+    // from the running mean (0 keeps all). Defaults are 50, 150 ms and 0;
+    // 0 samples is taken as 1.
+    void set_calibration_sampling(uint16_t samples, uint16_t interval, uint16_t outlier_limit);
+    // False without writing if fewer than half the readings succeeded
+    // (last_status() says why) or their SD is above 100 mV or 100 mA, and
+    // false if the write failed, as for apply_profile().
+    bool calibrate_voltage_divider(uint16_t applied_voltage, uint8_t cells_count);
+    bool calibrate_sense_resistor(int16_t applied_current);
     void set_current_deadband(uint8_t deadband);
     void ready();
     
+    // CC offset or board offset calibration as a state machine. Call poll()
+    // from the main loop until done(); each call reads CONTROL_STATUS at most
+    // once per poll_interval and never blocks.
+    class Calibration {
+    public:
+        enum Type { CC_OFFSET, BOARD_OFFSET };
+        enum Result { PENDING, OK, ENTER_TIMEOUT, START_TIMEOUT, RUN_TIMEOUT, EXIT_TIMEOUT };
+        
+        Calibration(BQ34Z100G1 &gauge, Type type, uint32_t timeout = 60000); // ms
+        
+        void start();
+        void poll();
+        bool done() const;
+        Result result() const;
+        
+        uint32_t poll_interval; // ms between CONTROL_STATUS reads
+        uint32_t retry_interval; // ms before a command the gauge ignored is resent
+        
+    private:
+        enum State { IDLE, ENTERING, STARTING, RUNNING, EXITING, RESETTING };
+        
+        BQ34Z100G1 &gauge;
+        Type type;
+        State state;
+        Result outcome;
+        uint32_t timeout;
+        uint32_t started;
+        uint32_t last_poll;
+        uint32_t last_command;
+        uint16_t resets;
+        
+        void command();
+        void finish(Result result);
+    };
+    
+private:
+    bool calibrate(Calibration &calibration);
+    
+public:
+    
+    // Identity and configuration values are read together on first use and
+    // served from RAM until reset(), which every update_* and calibrate_*
+    // ends with, or until the optional TTL expires.
+    const Identity &identity();
+    void set_identity_ttl(uint32_t ttl); // ms, 0 never expires
+    void invalidate_identity();
+    
     uint16_t control_status();
     uint16_t device_type();
     uint16_t fw_version();
@@ -83,6 +442,56 @@ public:
     uint16_t enter_cal();
     uint16_t offset_cal();
     
+    typedef BQ34Z100G1Register<0x02, uint8_t, BQ34Z100G1_UNIT_PERCENT> StateOfCharge;
+    typedef BQ34Z100G1Register<0x03, uint8_t, BQ34Z100G1_UNIT_PERCENT> StateOfChargeMaxError;
+    typedef BQ34Z100G1Register<0x04, uint16_t, BQ34Z100G1_UNIT_MAH> RemainingCapacity;
+    typedef BQ34Z100G1Register<0x06, uint16_t, BQ34Z100G1_UNIT_MAH> FullChargeCapacity;
+    typedef BQ34Z100G1Register<0x08, uint16_t, BQ34Z100G1_UNIT_MV> Voltage;
+    typedef BQ34Z100G1Register<0x0a, int16_t, BQ34Z100G1_UNIT_MA> AverageCurrent;
+    typedef BQ34Z100G1Register<0x0c, uint16_t, BQ34Z100G1_UNIT_KELVIN, 1, 10> Temperature;
+    typedef BQ34Z100G1Register<0x0e, uint16_t> Flags;
+    typedef BQ34Z100G1Register<0x10, int16_t, BQ34Z100G1_UNIT_MA> Current;
+    typedef BQ34Z100G1Register<0x12, uint16_t> FlagsB;
+    typedef BQ34Z100G1Register<0x18, uint16_t, BQ34Z100G1_UNIT_MINUTES> AverageTimeToEmpty;
+    typedef BQ34Z100G1Register<0x1a, uint16_t, BQ34Z100G1_UNIT_MINUTES> AverageTimeToFull;
+    typedef BQ34Z100G1Register<0x1c, int16_t, BQ34Z100G1_UNIT_MAH> PassedCharge;
+    typedef BQ34Z100G1Register<0x1e, uint16_t, BQ34Z100G1_UNIT_MINUTES> DoD0Time;
+    typedef BQ34Z100G1Register<0x24, uint16_t, BQ34Z100G1_UNIT_MWH, 10> AvailableEnergy;
+    typedef BQ34Z100G1Register<0x26, int16_t, BQ34Z100G1_UNIT_MW, 10> AveragePower;
+    typedef BQ34Z100G1Register<0x28, uint16_t> SerialNumber;
+    typedef BQ34Z100G1Register<0x2a, uint16_t, BQ34Z100G1_UNIT_KELVIN, 1, 10> InternalTemperature;
+    typedef BQ34Z100G1Register<0x2c, uint16_t> CycleCount;
+    typedef BQ34Z100G1Register<0x2e, uint16_t, BQ34Z100G1_UNIT_PERCENT> StateOfHealth;
+    typedef BQ34Z100G1Register<0x30, uint16_t, BQ34Z100G1_UNIT_MV> ChargeVoltage;
+    typedef BQ34Z100G1Register<0x32, uint16_t, BQ34Z100G1_UNIT_MA> ChargeCurrent;
+    typedef BQ34Z100G1Register<0x3a, uint16_t> PackConfiguration;
+    typedef BQ34Z100G1Register<0x3c, uint16_t, BQ34Z100G1_UNIT_MAH> DesignCapacity;
+    typedef BQ34Z100G1Register<0x62, uint8_t> GridNumber;
+    typedef BQ34Z100G1Register<0x63, uint8_t> LearnedStatus;
+    typedef BQ34Z100G1Register<0x64, uint16_t> DoDAtEoC;
+    typedef BQ34Z100G1Register<0x66, uint16_t, BQ34Z100G1_UNIT_MAH> QStart;
+    typedef BQ34Z100G1Register<0x68, uint16_t, BQ34Z100G1_UNIT_MAH> TrueRC;
+    typedef BQ34Z100G1Register<0x6a, uint16_t, BQ34Z100G1_UNIT_MAH> TrueFCC;
+    typedef BQ34Z100G1Register<0x6c, uint16_t, BQ34Z100G1_UNIT_SECONDS> StateTime;
+    typedef BQ34Z100G1Register<0x6e, uint16_t, BQ34Z100G1_UNIT_MAH> QMaxPassedQ;
+    typedef BQ34Z100G1Register<0x70, uint16_t> DoD0;
+    typedef BQ34Z100G1Register<0x72, uint16_t> QMaxDoD0;
+    typedef BQ34Z100G1Register<0x74, uint16_t> QMaxTime;
+    
+    template <class Register>
+    typename Register::type read() {
+        BQ34Z100G1_OPERATION(*this);
+        uint8_t data[Register::length];
+        read_block(Register::address, data, Register::length);
+        return Register::decode(data);
+    }
+    
+    template <class... Registers>
+    void read(BQ34Z100G1Burst<Registers...> &burst) {
+        BQ34Z100G1_OPERATION(*this);
+        read_block(burst.address, burst.data, burst.length);
+    }
+    
     uint8_t state_of_charge(); // 0 to 100%
     uint8_t state_of_charge_max_error(); // 1 to 100%
     uint16_t remaining_capacity(); // mAh
@@ -99,7 +508,7 @@ public:
     int16_t passed_charge(); // mAh
     uint16_t do_d0_time(); // Minutes
     uint16_t available_energy(); // 10 mWh
-    uint16_t average_power(); // 10 mW
+    int16_t average_power(); // 10 mW
     uint16_t serial_number();
     uint16_t internal_temperature(); // Unit of x10 K
     uint16_t cycle_count(); // Counts
@@ -0,0 +1,66 @@
+//
+//  bq34z100g1_alert.cpp
+//  SMC
+//
+
+#include "bq34z100g1_alert.hpp"
+
+static const uint32_t retry_interval = 100; // ms after a failed read
+
+BQ34Z100G1Alert::BQ34Z100G1Alert(BQ34Z100G1 &gauge) : gauge(gauge), count(0), heartbeat(60000), last_read(0), signalled(false), primed(false), retrying(false), last_flags(0) {
+}
+
+bool BQ34Z100G1Alert::on(uint16_t flags, Handler handler, void *context) {
+    if (count == BQ34Z100G1_ALERT_HANDLERS) {
+        return false;
+    }
+    Entry entry = {flags, handler, context};
+    entries[count++] = entry;
+    return true;
+}
+
+void BQ34Z100G1Alert::set_heartbeat(uint32_t interval) {
+    heartbeat = interval;
+}
+
+void BQ34Z100G1Alert::signal() {
+    signalled = true;
+}
+
+bool BQ34Z100G1Alert::poll() {
+    uint32_t now = gauge.bus.millis();
+    bool due;
+    if (retrying) {
+        due = now - last_read >= retry_interval;
+    } else {
+        due = !primed || (heartbeat && now - last_read >= heartbeat);
+    }
+    if (!signalled && !due) {
+        return false;
+    }
+    signalled = false; // Cleared first, so an edge during the read is not lost
+    uint16_t flags = gauge.flags();
+    last_read = now;
+    retrying = gauge.last_status() != BQ34Z100G1_STATUS_OK;
+    if (retrying) {
+        return false;
+    }
+    uint16_t changed = primed ? flags ^ last_flags : flags;
+    last_flags = flags;
+    primed = true;
+    
+    for (uint8_t n = 0; n < count; n++) {
+        uint16_t bits = changed & entries[n].flags;
+        for (uint16_t bit = 1; bits; bit <<= 1) {
+            if (bits & bit) {
+                bits &= ~bit;
+                entries[n].handler(bit, flags & bit, entries[n].context);
+            }
+        }
+    }
+    return true;
+}
+
+uint16_t BQ34Z100G1Alert::flags() const {
+    return last_flags;
+}
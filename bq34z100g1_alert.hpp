@@ -0,0 +1,63 @@
+//
+//  bq34z100g1_alert.hpp
+//  SMC
+//
+
+#ifndef bq34z100g1_alert_hpp
+#define bq34z100g1_alert_hpp
+
+#include "bq34z100g1.hpp"
+
+#ifndef BQ34Z100G1_ALERT_HANDLERS
+#define BQ34Z100G1_ALERT_HANDLERS 8
+#endif
+
+/*
+ Flag change events driven by the gauge's ALERT output. The gauge pulls ALERT
+ low while any Flags() bit enabled by update_alert_configuration() is set.
+
+ signal() is all the pin interrupt does. poll() from the main loop then reads
+ Flags() once, compares it with the last value and calls the handler of each
+ bit that changed. Without a signal it only reads on the heartbeat, to catch
+ bits outside the alert mask and edges that were missed. The first read
+ reports every bit already set.
+
+ On Linux, BQ34Z100G1GpioEdge in bq34z100g1_gpio.hpp waits for the pin.
+ */
+
+class BQ34Z100G1Alert {
+public:
+    typedef void (*Handler)(uint16_t flag, bool set, void *context);
+    
+    BQ34Z100G1Alert(BQ34Z100G1 &gauge);
+    
+    // handler is called once per changed bit of flags. False if all
+    // BQ34Z100G1_ALERT_HANDLERS are taken.
+    bool on(uint16_t flags, Handler handler, void *context = 0);
+    void set_heartbeat(uint32_t interval); // ms, default 60000, 0 for none
+    
+    void signal(); // From the interrupt handler
+    // Returns true if Flags() was read. A failed read is tried again 100 ms later.
+    bool poll();
+    
+    uint16_t flags() const; // Last value read
+    
+private:
+    struct Entry {
+        uint16_t flags;
+        Handler handler;
+        void *context;
+    };
+    
+    BQ34Z100G1 &gauge;
+    Entry entries[BQ34Z100G1_ALERT_HANDLERS];
+    uint8_t count;
+    uint32_t heartbeat;
+    uint32_t last_read;
+    volatile bool signalled;
+    bool primed; // last_flags holds a value read from the gauge
+    bool retrying; // Last read failed
+    uint16_t last_flags;
+};
+
+#endif /* bq34z100g1_alert_hpp */
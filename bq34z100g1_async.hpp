@@ -0,0 +1,184 @@
+//
+//  bq34z100g1_async.hpp
+//  SMC
+//
+
+#ifndef bq34z100g1_async_hpp
+#define bq34z100g1_async_hpp
+
+#include "bq34z100g1.hpp"
+
+/*
+ Non-blocking register reads on an interrupt or DMA driven I2C driver.
+
+ The transport is any class with
+
+     bool start(uint8_t device, uint8_t address, uint8_t *data, uint8_t length);
+     bool done(); // Set by the driver's completion interrupt
+     BQ34Z100G1Status status(); // Of the last finished transfer
+
+ start() only queues the transfer and returns false if the driver is busy.
+
+ Requests are owned by the caller and linked into the reader's queue, so
+ nothing is allocated. poll() from the main loop hands finished requests to
+ their callback, outside interrupt context, and starts the next one. A
+ request can also be watched through its done flag.
+
+ BQ34Z100G1SimulatedTransport completes transfers through a synchronous bus
+ when complete() is called, standing in for the interrupt on a host build.
+ */
+
+class BQ34Z100G1AsyncRequest {
+public:
+    typedef void (*Callback)(BQ34Z100G1AsyncRequest &request);
+    
+    uint8_t address;
+    uint8_t length;
+    uint8_t *data;
+    Callback callback; // May be 0
+    void *context; // For the callback
+    volatile bool done;
+    BQ34Z100G1Status status;
+    
+    BQ34Z100G1AsyncRequest() : address(0), length(0), data(0), callback(0), context(0), done(true), status(BQ34Z100G1_STATUS_OK), next(0) {}
+    
+    template <class Register>
+    typename Register::type get() const {
+        return Register::decode(data);
+    }
+    
+private:
+    template <class Transport> friend class BQ34Z100G1AsyncReader;
+    
+    BQ34Z100G1AsyncRequest *next;
+};
+
+template <class Transport>
+class BQ34Z100G1AsyncReader {
+    Transport &transport;
+    uint8_t device;
+    BQ34Z100G1AsyncRequest *head; // In flight once started
+    BQ34Z100G1AsyncRequest *tail;
+    bool started;
+    
+    void start_next() {
+        started = head && transport.start(device, head->address, head->data, head->length);
+    }
+    
+public:
+    BQ34Z100G1AsyncReader(Transport &transport, uint8_t device = BQ34Z100_G1_ADDRESS) : transport(transport), device(device), head(0), tail(0), started(false) {}
+    
+    // Returns false if the request is still queued from an earlier read.
+    bool begin_read(BQ34Z100G1AsyncRequest &request, uint8_t address, uint8_t *data, uint8_t length, BQ34Z100G1AsyncRequest::Callback callback = 0, void *context = 0) {
+        if (!request.done) {
+            return false;
+        }
+        request.address = address;
+        request.length = length;
+        request.data = data;
+        request.callback = callback;
+        request.context = context;
+        request.done = false;
+        request.next = 0;
+        if (tail) {
+            tail->next = &request;
+        } else {
+            head = &request;
+        }
+        tail = &request;
+        if (!started) {
+            start_next();
+        }
+        return true;
+    }
+    
+    // data must hold Register::length bytes, decode with request.get<Register>().
+    template <class Register>
+    bool begin_read(BQ34Z100G1AsyncRequest &request, uint8_t *data, BQ34Z100G1AsyncRequest::Callback callback = 0, void *context = 0) {
+        return begin_read(request, Register::address, data, Register::length, callback, context);
+    }
+    
+    template <class... Registers>
+    bool begin_read(BQ34Z100G1AsyncRequest &request, BQ34Z100G1Burst<Registers...> &burst, BQ34Z100G1AsyncRequest::Callback callback = 0, void *context = 0) {
+        return begin_read(request, burst.address, burst.data, burst.length, callback, context);
+    }
+    
+    // One transfer, without the mid-update check of BQ34Z100G1::snapshot().
+    bool begin_snapshot(BQ34Z100G1AsyncRequest &request, BQ34Z100G1::Snapshot &snapshot, BQ34Z100G1AsyncRequest::Callback callback = 0, void *context = 0) {
+        return begin_read(request, 0x02, (uint8_t *)&snapshot, sizeof(snapshot), callback, context);
+    }
+    
+    void poll() {
+        if (!started) {
+            start_next(); // Driver was busy at submit time
+            return;
+        }
+        if (!transport.done()) {
+            return;
+        }
+        BQ34Z100G1AsyncRequest &request = *head;
+        head = head->next;
+        if (!head) {
+            tail = 0;
+        }
+        request.status = transport.status();
+        request.done = true;
+        start_next();
+        if (request.callback) {
+            request.callback(request); // May queue another read
+        }
+    }
+    
+    bool idle() const {
+        return !head;
+    }
+};
+
+template <class Bus>
+class BQ34Z100G1SimulatedTransport {
+    Bus &bus;
+    bool pending;
+    bool finished;
+    BQ34Z100G1Status last;
+    uint8_t device;
+    uint8_t address;
+    uint8_t *data;
+    uint8_t length;
+    
+public:
+    BQ34Z100G1SimulatedTransport(Bus &bus) : bus(bus), pending(false), finished(false), last(BQ34Z100G1_STATUS_OK), device(0), address(0), data(0), length(0) {}
+    
+    bool start(uint8_t device, uint8_t address, uint8_t *data, uint8_t length) {
+        if (pending) {
+            return false;
+        }
+        this->device = device;
+        this->address = address;
+        this->data = data;
+        this->length = length;
+        pending = true;
+        finished = false;
+        return true;
+    }
+    
+    bool done() {
+        return finished;
+    }
+    
+    BQ34Z100G1Status status() {
+        return last;
+    }
+    
+    // The completion interrupt: runs the queued transfer, returns false if none.
+    bool complete() {
+        if (!pending) {
+            return false;
+        }
+        last = bus.read(device, address, data, length);
+        pending = false;
+        finished = true;
+        return true;
+    }
+};
+
+#endif /* bq34z100g1_async_hpp */
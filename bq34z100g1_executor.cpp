@@ -0,0 +1,75 @@
+//
+//  bq34z100g1_executor.cpp
+//  SMC
+//
+
+#if !defined(ARDUINO) && defined(__linux__)
+
+#include "bq34z100g1_executor.hpp"
+
+BQ34Z100G1Executor::Worker::Worker(int adapter) : bus_adapter(adapter), stopping(false), thread(&Worker::loop, this) {
+}
+
+BQ34Z100G1Executor::Worker::~Worker() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+void BQ34Z100G1Executor::Worker::post(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    wake.notify_one();
+}
+
+void BQ34Z100G1Executor::Worker::loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [this]() { return stopping || !jobs.empty(); });
+        if (jobs.empty()) {
+            return; // Stopping with nothing left
+        }
+        std::function<void()> job = std::move(jobs.front());
+        jobs.pop_front();
+        lock.unlock();
+        job();
+        lock.lock();
+    }
+}
+
+BQ34Z100G1Executor::~BQ34Z100G1Executor() {
+    workers.clear(); // Each worker drains its queue before joining
+}
+
+int BQ34Z100G1Executor::add(BQ34Z100G1 &gauge, int adapter) {
+    size_t worker = 0;
+    while (worker < workers.size() && workers[worker]->adapter() != adapter) {
+        worker++;
+    }
+    if (worker == workers.size()) {
+        workers.push_back(std::unique_ptr<Worker>(new Worker(adapter)));
+    }
+    Member member = {&gauge, worker};
+    gauges.push_back(member);
+    return gauges.size() - 1;
+}
+
+size_t BQ34Z100G1Executor::size() const {
+    return gauges.size();
+}
+
+std::future<BQ34Z100G1Executor::Sample> BQ34Z100G1Executor::sample(int index) {
+    return run(index, [](BQ34Z100G1 &gauge) {
+        Sample sample;
+        sample.consistent = gauge.snapshot(sample.snapshot);
+        sample.status = gauge.last_status();
+        return sample;
+    });
+}
+
+#endif
@@ -0,0 +1,91 @@
+//
+//  bq34z100g1_executor.hpp
+//  SMC
+//
+
+#ifndef bq34z100g1_executor_hpp
+#define bq34z100g1_executor_hpp
+
+#if !defined(ARDUINO) && defined(__linux__)
+
+#include "bq34z100g1.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ Polls gauges on several I2C adapters in parallel, one worker thread per
+ adapter. Calls to gauges on the same adapter run one after another on its
+ worker, calls on different adapters overlap. Callers get a std::future and
+ never touch a gauge directly once it has been added.
+ */
+
+class BQ34Z100G1Executor {
+public:
+    struct Sample {
+        BQ34Z100G1::Snapshot snapshot;
+        bool consistent; // From BQ34Z100G1::snapshot()
+        BQ34Z100G1Status status;
+    };
+    
+    BQ34Z100G1Executor() {}
+    ~BQ34Z100G1Executor(); // Finishes queued calls
+    
+    // Returns the gauge index. Gauges with the same adapter share a worker.
+    int add(BQ34Z100G1 &gauge, int adapter);
+    size_t size() const;
+    
+    std::future<Sample> sample(int index);
+    
+    // Runs call(gauge) on the gauge's worker.
+    template <class Call>
+    std::future<typename std::result_of<Call(BQ34Z100G1 &)>::type> run(int index, Call call) {
+        typedef typename std::result_of<Call(BQ34Z100G1 &)>::type Result;
+        BQ34Z100G1 *gauge = gauges[index].gauge;
+        std::shared_ptr<std::packaged_task<Result()> > task(new std::packaged_task<Result()>([gauge, call]() mutable { return call(*gauge); }));
+        std::future<Result> result = task->get_future();
+        workers[gauges[index].worker]->post([task]() { (*task)(); });
+        return result;
+    }
+    
+private:
+    class Worker {
+    public:
+        explicit Worker(int adapter);
+        ~Worker();
+        
+        int adapter() const { return bus_adapter; }
+        void post(std::function<void()> job);
+        
+    private:
+        int bus_adapter;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::deque<std::function<void()> > jobs;
+        bool stopping;
+        std::thread thread;
+        
+        void loop();
+    };
+    
+    struct Member {
+        BQ34Z100G1 *gauge;
+        size_t worker;
+    };
+    
+    std::vector<std::unique_ptr<Worker> > workers;
+    std::vector<Member> gauges;
+    
+    BQ34Z100G1Executor(const BQ34Z100G1Executor &);
+    BQ34Z100G1Executor &operator=(const BQ34Z100G1Executor &);
+};
+
+#endif
+
+#endif /* bq34z100g1_executor_hpp */
@@ -0,0 +1,243 @@
+//
+//  bq34z100g1_flash.cpp
+//  SMC
+//
+
+#include "bq34z100g1_flash.hpp"
+
+namespace {
+
+struct SubClass {
+    uint8_t id;
+    uint8_t blocks;
+    uint8_t learned_offset; // Bytes the gauge learns or counts for this pack
+    uint8_t learned_length;
+};
+
+// Data flash summary of the bq34z100-G1, security codes left out.
+constexpr SubClass sub_classes[] = {
+    {2, 1, 0, 0}, // Safety
+    {32, 1, 0, 0}, // Charge Inhibit Cfg
+    {34, 1, 0, 0}, // Charge
+    {36, 1, 0, 0}, // Charge Termination
+    {48, 2, 6, 2}, // Data, cycle count
+    {49, 1, 0, 0}, // Discharge
+    {56, 1, 0, 0}, // Manufacturer Data
+    {58, 1, 0, 0}, // Manufacturer Info
+    {59, 1, 0, 32}, // Lifetime Data
+    {60, 1, 0, 32}, // Lifetime Temp Samples
+    {64, 1, 0, 0}, // Registers
+    {66, 1, 0, 0}, // Lifetime Resolution
+    {67, 1, 0, 0}, // LED Display
+    {68, 1, 0, 0}, // Power
+    {80, 3, 0, 0}, // IT Cfg
+    {81, 1, 0, 0}, // Current Thresholds
+    {82, 1, 0, 32}, // State, Qmax and Update Status
+    {83, 1, 0, 32}, // R_a0
+    {84, 1, 0, 32}, // R_a0x
+    {104, 1, 0, 0}, // Data (calibration)
+    {107, 1, 0, 0}, // Current
+};
+
+constexpr uint8_t sub_class_count = sizeof(sub_classes) / sizeof(sub_classes[0]);
+
+constexpr uint8_t blocks_before(uint8_t n) {
+    return n == 0 ? 0 : sub_classes[n - 1].blocks + blocks_before(n - 1);
+}
+
+constexpr uint8_t block_total = blocks_before(sub_class_count);
+
+uint8_t block_count() {
+    return block_total;
+}
+
+// Position of a block in a dump() image, -1 for blocks dump() leaves out.
+// learned gets the bytes of the block the gauge updates itself.
+int16_t block_position(uint8_t sub_class, uint8_t block, uint32_t &learned) {
+    for (uint8_t n = 0; n < sub_class_count; n++) {
+        const SubClass &entry = sub_classes[n];
+        if (entry.id != sub_class) {
+            continue;
+        }
+        if (block >= entry.blocks) {
+            return -1;
+        }
+        learned = 0;
+        for (uint8_t i = 0; i < 32; i++) {
+            uint16_t offset = block * 32 + i;
+            if (offset >= entry.learned_offset && offset < entry.learned_offset + entry.learned_length) {
+                learned |= 1UL << i;
+            }
+        }
+        return blocks_before(n) + block;
+    }
+    return -1;
+}
+
+}
+
+uint16_t BQ34Z100G1FlashImage::size() {
+    return header_length + block_count() * entry_length + 1;
+}
+
+uint8_t BQ34Z100G1FlashImage::checksum(const uint8_t *image, uint16_t length) {
+    uint8_t sum = 0;
+    for (uint16_t i = 0; i < length; i++) {
+        sum += image[i];
+    }
+    return 255 - sum;
+}
+
+uint16_t BQ34Z100G1FlashImage::dump(BQ34Z100G1 &gauge, uint8_t *image, uint16_t capacity) {
+    BQ34Z100G1_OPERATION(gauge);
+    uint16_t length = size();
+    if (capacity < length) {
+        return 0;
+    }
+    const BQ34Z100G1::Identity &identity = gauge.identity();
+    image[0] = 'D';
+    image[1] = 'F';
+    image[2] = version;
+    image[3] = block_count();
+    image[4] = identity.df_version >> 8;
+    image[5] = identity.df_version & 0xff;
+    image[6] = identity.chem_id >> 8;
+    image[7] = identity.chem_id & 0xff;
+    
+    uint8_t *entry = image + header_length;
+    for (uint8_t n = 0; n < sub_class_count; n++) {
+        for (uint8_t block = 0; block < sub_classes[n].blocks; block++) {
+            gauge.read_flash_block(sub_classes[n].id, block * 32);
+            if (!gauge.flash_block->valid) {
+                return 0;
+            }
+            entry[0] = sub_classes[n].id;
+            entry[1] = block;
+            memcpy(entry + 2, gauge.flash_block->data, 32);
+            entry += entry_length;
+        }
+    }
+    image[length - 1] = checksum(image, length - 1);
+    return length;
+}
+
+bool BQ34Z100G1FlashImage::valid(const uint8_t *image, uint16_t length) {
+    if (length < header_length + 1 || image[0] != 'D' || image[1] != 'F' || image[2] != version) {
+        return false;
+    }
+    if (length != header_length + image[3] * entry_length + 1) {
+        return false;
+    }
+    return checksum(image, length - 1) == image[length - 1];
+}
+
+const uint8_t *BQ34Z100G1FlashImage::find(const uint8_t *image, uint8_t sub_class, uint8_t block) {
+    const uint8_t *entry = image + header_length;
+    for (uint8_t n = 0; n < image[3]; n++, entry += entry_length) {
+        if (entry[0] == sub_class && entry[1] == block) {
+            return entry;
+        }
+    }
+    return 0;
+}
+
+uint8_t BQ34Z100G1FlashImage::diff(const uint8_t *a, const uint8_t *b, Difference *differences, uint8_t capacity) {
+    static const uint8_t zero[entry_length] = {0};
+    uint8_t count = 0;
+    
+    // Blocks missing from one image compare against zeros.
+    for (uint8_t pass = 0; pass < 2; pass++) {
+        const uint8_t *image = pass == 0 ? a : b;
+        const uint8_t *other = pass == 0 ? b : a;
+        const uint8_t *entry = image + header_length;
+        for (uint8_t n = 0; n < image[3]; n++, entry += entry_length) {
+            const uint8_t *match = find(other, entry[0], entry[1]);
+            if (pass == 1 && match) {
+                continue; // Compared in the first pass
+            }
+            const uint8_t *left = entry + 2;
+            const uint8_t *right = match ? match + 2 : zero;
+            for (uint8_t i = 0; i < 32; i++) {
+                if (left[i] == right[i]) {
+                    continue;
+                }
+                uint8_t first = i;
+                while (i + 1 < 32 && left[i + 1] != right[i + 1]) {
+                    i++;
+                }
+                if (count < capacity) {
+                    differences[count].sub_class = entry[0];
+                    differences[count].offset = entry[1] * 32 + first;
+                    differences[count].length = i - first + 1;
+                }
+                if (count < 0xff) {
+                    count++;
+                }
+            }
+        }
+    }
+    return count;
+}
+
+bool BQ34Z100G1FlashImage::restore(BQ34Z100G1 &gauge, const uint8_t *image, uint16_t length, bool learned) {
+    BQ34Z100G1_OPERATION(gauge);
+    if (!valid(image, length)) {
+        return false;
+    }
+    const BQ34Z100G1::Identity &identity = gauge.identity();
+    if (identity.df_version != (uint16_t)(image[4] << 8 | image[5]) || identity.chem_id != (uint16_t)(image[6] << 8 | image[7])) {
+        return false;
+    }
+    
+    bool verified = true;
+    bool changed = false;
+    uint32_t written[block_total]; // Bytes written, by position
+    memset(written, 0, sizeof(written));
+    const uint8_t *entry = image + header_length;
+    for (uint8_t n = 0; n < image[3]; n++, entry += entry_length) {
+        uint32_t skip;
+        int16_t position = block_position(entry[0], entry[1], skip);
+        if (position < 0) {
+            continue; // Security codes, or not from dump()
+        }
+        if (learned) {
+            skip = 0;
+        }
+        gauge.read_flash_block(entry[0], entry[1] * 32);
+        if (!gauge.flash_block->valid) {
+            return false; // Blocks written so far are consistent on their own
+        }
+        for (uint8_t i = 0; i < 32; i++) {
+            if (!(skip & 1UL << i)) {
+                gauge.set_flash_byte(i, entry[2 + i]);
+            }
+        }
+        if (gauge.flash_block->dirty) {
+            written[position] |= gauge.flash_block->dirty;
+            verified &= gauge.flush_flash_block(*gauge.flash_block);
+            gauge.flash_block->written = 0; // Read back below instead
+            changed = true;
+        }
+    }
+    if (!changed) {
+        return verified;
+    }
+    
+    verified &= gauge.reset_and_wait();
+    entry = image + header_length;
+    for (uint8_t n = 0; n < image[3]; n++, entry += entry_length) {
+        uint32_t skip;
+        int16_t position = block_position(entry[0], entry[1], skip);
+        if (position < 0 || !written[position]) {
+            continue;
+        }
+        gauge.read_flash_block(entry[0], entry[1] * 32);
+        verified &= gauge.flash_block->valid;
+        for (uint8_t i = 0; i < 32; i++) {
+            if (written[position] & 1UL << i) {
+                verified &= gauge.flash_block->data[i] == entry[2 + i];
+            }
+        }
+    }
+    return verified;
+}
@@ -0,0 +1,53 @@
+//
+//  bq34z100g1_flash.hpp
+//  SMC
+//
+
+#ifndef bq34z100g1_flash_hpp
+#define bq34z100g1_flash_hpp
+
+#include "bq34z100g1.hpp"
+
+/*
+ Whole data flash images, for copying the configuration of a known good pack
+ onto others.
+
+ An image is an 8 byte header ('D', 'F', version, block count, DF version and
+ chem ID of the source gauge, big endian), one entry per 32 byte block
+ (subclass, block, data) and a checksum byte. The security codes (subclass
+ 112) are never dumped or restored.
+
+ restore() writes only the blocks that differ from the gauge, each checked
+ through the block checksum, then resets once and reads back the bytes it
+ wrote. It refuses images taken from a gauge with another DF version or chem
+ ID. Unless asked to, it leaves alone what the gauge learns or counts for its
+ own pack: the cycle count, Lifetime (59, 60), State (82, Qmax and Update
+ Status) and the Ra tables (83, 84).
+ */
+
+class BQ34Z100G1FlashImage {
+public:
+    static const uint8_t version = 1;
+    static const uint8_t header_length = 8;
+    static const uint8_t entry_length = 34;
+    
+    struct Difference {
+        uint8_t sub_class;
+        uint8_t offset; // From the start of the subclass
+        uint8_t length;
+    };
+    
+    static uint16_t size(); // Bytes needed by dump()
+    static uint16_t dump(BQ34Z100G1 &gauge, uint8_t *image, uint16_t capacity); // Returns 0 if capacity is too small
+    static bool valid(const uint8_t *image, uint16_t length);
+    // Fills up to capacity differences, one per changed run of bytes, and
+    // returns how many there are. Both images must be valid().
+    static uint8_t diff(const uint8_t *a, const uint8_t *b, Difference *differences, uint8_t capacity);
+    static bool restore(BQ34Z100G1 &gauge, const uint8_t *image, uint16_t length, bool learned = false);
+    
+private:
+    static const uint8_t *find(const uint8_t *image, uint8_t sub_class, uint8_t block);
+    static uint8_t checksum(const uint8_t *image, uint16_t length);
+};
+
+#endif /* bq34z100g1_flash_hpp */
@@ -0,0 +1,116 @@
+//
+//  bq34z100g1_fleet.cpp
+//  SMC
+//
+
+#include "bq34z100g1_fleet.hpp"
+
+BQ34Z100G1Fleet::BQ34Z100G1Fleet(const BQ34Z100G1_BUS &bus, uint8_t mux_address) : bus(bus), mux_address(mux_address), mux_channel(NO_MUX), count(0), fast_interval(1000), slow_interval(60000) {
+}
+
+int8_t BQ34Z100G1Fleet::add(BQ34Z100G1 &gauge, uint8_t mux_channel) {
+    if (count >= BQ34Z100G1_FLEET_SIZE || (mux_channel > 7 && mux_channel != NO_MUX)) {
+        return -1; // The TCA9548A has channels 0 to 7
+    }
+    uint8_t index = count++;
+    members[index].gauge = &gauge;
+    members[index].channel = mux_channel;
+    memset(&members[index].sample, 0, sizeof(Sample));
+    
+    uint8_t position = index;
+    while (position > 0 && members[order[position - 1]].channel > mux_channel) {
+        order[position] = order[position - 1];
+        position--;
+    }
+    order[position] = index;
+    return index;
+}
+
+void BQ34Z100G1Fleet::set_intervals(uint32_t fast, uint32_t slow) {
+    fast_interval = fast;
+    slow_interval = slow;
+}
+
+BQ34Z100G1Status BQ34Z100G1Fleet::switch_channel(uint8_t channel) {
+    if (channel == NO_MUX || channel == mux_channel) {
+        return BQ34Z100G1_STATUS_OK; // Gauges outside the mux answer on any channel
+    }
+    uint8_t none = 0;
+    BQ34Z100G1Status status = bus.write(mux_address, 1 << channel, &none, 0); // The channel mask is the only byte sent
+    mux_channel = status == BQ34Z100G1_STATUS_OK ? channel : NO_MUX; // Unknown, select again next time
+    return status;
+}
+
+void BQ34Z100G1Fleet::poll_member(Member &member, uint32_t now) {
+    Sample &sample = member.sample;
+    bool fast = sample.fast_time == 0 || now - sample.fast_time >= fast_interval;
+    bool slow = sample.slow_time == 0 || now - sample.slow_time >= slow_interval;
+    if (!fast && !slow) {
+        return;
+    }
+    sample.status = switch_channel(member.channel);
+    if (sample.status != BQ34Z100G1_STATUS_OK) {
+        return;
+    }
+    
+    BQ34Z100G1Burst<BQ34Z100G1::StateOfCharge, BQ34Z100G1::Current> fast_burst;
+    member.gauge->read(fast_burst);
+    sample.status = member.gauge->last_status();
+    if (sample.status != BQ34Z100G1_STATUS_OK) {
+        return;
+    }
+    sample.state_of_charge = fast_burst.get<BQ34Z100G1::StateOfCharge>();
+    sample.remaining_capacity = fast_burst.get<BQ34Z100G1::RemainingCapacity>();
+    sample.voltage = fast_burst.get<BQ34Z100G1::Voltage>();
+    sample.average_current = fast_burst.get<BQ34Z100G1::AverageCurrent>();
+    sample.temperature = fast_burst.get<BQ34Z100G1::Temperature>();
+    sample.flags = fast_burst.get<BQ34Z100G1::Flags>();
+    sample.current = fast_burst.get<BQ34Z100G1::Current>();
+    sample.fast_time = now ? now : 1;
+    
+    if (slow) {
+        sample.full_charge_capacity = fast_burst.get<BQ34Z100G1::FullChargeCapacity>();
+        
+        BQ34Z100G1Burst<BQ34Z100G1::CycleCount, BQ34Z100G1::StateOfHealth> slow_burst;
+        member.gauge->read(slow_burst);
+        sample.status = member.gauge->last_status();
+        if (sample.status != BQ34Z100G1_STATUS_OK) {
+            return;
+        }
+        sample.cycle_count = slow_burst.get<BQ34Z100G1::CycleCount>();
+        sample.state_of_health = slow_burst.get<BQ34Z100G1::StateOfHealth>();
+        sample.slow_time = now ? now : 1;
+    }
+}
+
+void BQ34Z100G1Fleet::poll() {
+    if (count == 0) {
+        return;
+    }
+    uint32_t now = bus.millis();
+    
+    // Start with the gauges on the channel already selected.
+    uint8_t first = 0;
+    while (first < count && members[order[first]].channel < mux_channel) {
+        first++;
+    }
+    if (first == count || members[order[first]].channel != mux_channel) {
+        first = 0;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        poll_member(members[order[(first + i) % count]], now);
+    }
+}
+
+uint8_t BQ34Z100G1Fleet::size() const {
+    return count;
+}
+
+const BQ34Z100G1Fleet::Sample &BQ34Z100G1Fleet::sample(uint8_t index) const {
+    return members[index].sample;
+}
+
+BQ34Z100G1 &BQ34Z100G1Fleet::select(uint8_t index) {
+    switch_channel(members[index].channel);
+    return *members[index].gauge;
+}
@@ -0,0 +1,81 @@
+//
+//  bq34z100g1_fleet.hpp
+//  SMC
+//
+
+#ifndef bq34z100g1_fleet_hpp
+#define bq34z100g1_fleet_hpp
+
+#include "bq34z100g1.hpp"
+
+#ifndef BQ34Z100G1_FLEET_SIZE
+#define BQ34Z100G1_FLEET_SIZE 8
+#endif
+
+/*
+ Polls several gauges on one bus, optionally behind a TCA9548A style mux.
+ Fast values are read every fast interval in one burst per gauge, slow values
+ every slow interval. Gauges are visited grouped by mux channel, starting with
+ the channel already selected, so each round switches the mux at most once
+ per channel in use. The application reads the cached samples. A failed
+ read is tried again on the next poll.
+ */
+
+class BQ34Z100G1Fleet {
+public:
+    static const uint8_t NO_MUX = 0xff;
+    
+    struct Sample {
+        uint8_t state_of_charge; // 0 to 100%
+        uint16_t remaining_capacity; // mAh
+        uint16_t voltage; // mV
+        int16_t average_current; // mA
+        uint16_t temperature; // Unit of x10 K
+        uint16_t flags;
+        int16_t current; // mA
+        uint32_t fast_time; // millis() of the last fast read, 0 before the first
+        
+        uint16_t full_charge_capacity; // mAh
+        uint16_t cycle_count; // Counts
+        uint16_t state_of_health; // 0 to 100%
+        uint32_t slow_time; // millis() of the last slow read, 0 before the first
+        
+        BQ34Z100G1Status status; // Of the last poll; a failed read keeps the earlier values and times
+    };
+    
+    BQ34Z100G1Fleet(const BQ34Z100G1_BUS &bus = BQ34Z100G1_BUS(), uint8_t mux_address = 0x70);
+    
+    // Returns the gauge index, or -1 if the fleet is full or the channel is not 0 to 7.
+    int8_t add(BQ34Z100G1 &gauge, uint8_t mux_channel = NO_MUX);
+    void set_intervals(uint32_t fast, uint32_t slow); // ms, defaults 1000 and 60000
+    
+    // Reads whatever is due. Call from the main loop.
+    void poll();
+    
+    uint8_t size() const;
+    const Sample &sample(uint8_t index) const;
+    
+    // Switches the mux to the gauge's channel for direct use.
+    BQ34Z100G1 &select(uint8_t index);
+    
+private:
+    struct Member {
+        BQ34Z100G1 *gauge;
+        uint8_t channel;
+        Sample sample;
+    };
+    
+    BQ34Z100G1_BUS bus;
+    uint8_t mux_address;
+    uint8_t mux_channel; // Channel currently selected
+    Member members[BQ34Z100G1_FLEET_SIZE];
+    uint8_t order[BQ34Z100G1_FLEET_SIZE]; // Member indexes sorted by channel
+    uint8_t count;
+    uint32_t fast_interval;
+    uint32_t slow_interval;
+    
+    BQ34Z100G1Status switch_channel(uint8_t channel);
+    void poll_member(Member &member, uint32_t now);
+};
+
+#endif /* bq34z100g1_fleet_hpp */
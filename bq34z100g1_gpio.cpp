@@ -0,0 +1,55 @@
+//
+//  bq34z100g1_gpio.cpp
+//  SMC
+//
+
+#if !defined(ARDUINO) && defined(__linux__)
+
+#include "bq34z100g1_gpio.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+
+bool BQ34Z100G1GpioEdge::open(uint8_t chip, uint32_t line) {
+    close();
+    char path[24];
+    snprintf(path, sizeof(path), "/dev/gpiochip%u", chip);
+    int chip_fd = ::open(path, O_RDWR | O_CLOEXEC);
+    if (chip_fd < 0) {
+        return false;
+    }
+    struct gpio_v2_line_request request;
+    memset(&request, 0, sizeof(request));
+    request.offsets[0] = line;
+    request.num_lines = 1;
+    strcpy(request.consumer, "bq34z100g1");
+    request.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING;
+    if (ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &request) == 0) {
+        fd = request.fd; // Stays valid after the chip is closed
+    }
+    ::close(chip_fd);
+    return fd >= 0;
+}
+
+void BQ34Z100G1GpioEdge::close() {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+bool BQ34Z100G1GpioEdge::wait(int timeout) {
+    struct pollfd ready = {fd, POLLIN, 0};
+    if (fd < 0 || poll(&ready, 1, timeout) <= 0 || !(ready.revents & POLLIN)) {
+        return false;
+    }
+    struct gpio_v2_line_event events[16];
+    return read(fd, events, sizeof(events)) > 0;
+}
+
+#endif
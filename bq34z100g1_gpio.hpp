@@ -0,0 +1,41 @@
+//
+//  bq34z100g1_gpio.hpp
+//  SMC
+//
+
+#ifndef bq34z100g1_gpio_hpp
+#define bq34z100g1_gpio_hpp
+
+#include <stdint.h>
+
+/*
+ Edges on a GPIO line through the Linux GPIO character device, for the
+ gauge's ALERT output. Both edges are watched, so clearing flags are seen as
+ well as new ones. ALERT is open drain and needs an external pull up.
+
+     while (running) {
+         if (edge.wait(1000)) {
+             alert.signal();
+         }
+         alert.poll();
+     }
+
+ descriptor() can be added to an existing poll() or epoll loop instead.
+ */
+
+class BQ34Z100G1GpioEdge {
+    int fd;
+    
+public:
+    BQ34Z100G1GpioEdge() : fd(-1) {}
+    
+    bool open(uint8_t chip, uint32_t line); // /dev/gpiochip<chip>
+    void close();
+    int descriptor() const { return fd; }
+    
+    // Waits up to timeout ms, -1 for ever. Returns true and consumes the
+    // queued events if any edge arrived.
+    bool wait(int timeout);
+};
+
+#endif /* bq34z100g1_gpio_hpp */
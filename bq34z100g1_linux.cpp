@@ -0,0 +1,107 @@
+//
+//  bq34z100g1_linux.cpp
+//  SMC
+//
+
+#if !defined(ARDUINO) && defined(__linux__)
+
+#include "bq34z100g1_linux.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+bool BQ34Z100G1LinuxBus::open(uint8_t adapter) {
+    char path[16];
+    snprintf(path, sizeof(path), "/dev/i2c-%u", adapter);
+    fd = ::open(path, O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    ioctl(fd, I2C_TIMEOUT, 10); // 100 ms, in units of 10 ms
+    ioctl(fd, I2C_RETRIES, 0); // Retries are left to the gauge
+    return true;
+}
+
+void BQ34Z100G1LinuxBus::close() {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+static BQ34Z100G1Status transfer_status(int fd, struct i2c_rdwr_ioctl_data &transfer) {
+    if (ioctl(fd, I2C_RDWR, &transfer) == (int)transfer.nmsgs) {
+        return BQ34Z100G1_STATUS_OK;
+    }
+    return errno == ETIMEDOUT ? BQ34Z100G1_STATUS_TIMEOUT : BQ34Z100G1_STATUS_NACK;
+}
+
+BQ34Z100G1Status BQ34Z100G1LinuxBus::read(uint8_t device, uint8_t address, uint8_t *data, uint8_t length) {
+    struct i2c_msg messages[2];
+    messages[0].addr = device;
+    messages[0].flags = 0;
+    messages[0].len = 1;
+    messages[0].buf = &address;
+    messages[1].addr = device;
+    messages[1].flags = I2C_M_RD;
+    messages[1].len = length;
+    messages[1].buf = data;
+    
+    struct i2c_rdwr_ioctl_data transfer;
+    transfer.msgs = messages;
+    transfer.nmsgs = 2;
+    return transfer_status(fd, transfer);
+}
+
+BQ34Z100G1Status BQ34Z100G1LinuxBus::write(uint8_t device, uint8_t address, const uint8_t *data, uint8_t length) {
+    uint8_t buffer[1 + 255];
+    buffer[0] = address;
+    if (length > 0) {
+        memcpy(buffer + 1, data, length);
+    }
+    
+    struct i2c_msg message;
+    message.addr = device;
+    message.flags = 0;
+    message.len = length + 1;
+    message.buf = buffer;
+    
+    struct i2c_rdwr_ioctl_data transfer;
+    transfer.msgs = &message;
+    transfer.nmsgs = 1;
+    return transfer_status(fd, transfer);
+}
+
+void BQ34Z100G1LinuxBus::recover() {
+    // Adapter drivers with recovery support clock the bus free themselves
+    // when a transfer times out; there is no user space request for it.
+}
+
+void BQ34Z100G1LinuxBus::delay(uint32_t ms) {
+    struct timespec duration;
+    duration.tv_sec = ms / 1000;
+    duration.tv_nsec = (ms % 1000) * 1000000L;
+    while (nanosleep(&duration, &duration) != 0) {
+    }
+}
+
+uint32_t BQ34Z100G1LinuxBus::millis() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000UL + now.tv_nsec / 1000000L;
+}
+
+uint32_t BQ34Z100G1LinuxBus::micros() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000UL + now.tv_nsec / 1000L;
+}
+
+#endif
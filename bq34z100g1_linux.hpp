@@ -0,0 +1,43 @@
+//
+//  bq34z100g1_linux.hpp
+//  SMC
+//
+
+#ifndef bq34z100g1_linux_hpp
+#define bq34z100g1_linux_hpp
+
+#include <stdint.h>
+
+#include "bq34z100g1_status.hpp"
+
+/*
+ Bus transport over Linux i2c-dev. A register read is a single I2C_RDWR call
+ with a repeated start between the address write and the data read.
+
+ The bus is a handle to an open /dev/i2c-N descriptor and is copied into each
+ gauge, so open() it once and close() it after the last gauge is done. It can
+ be exercised without hardware through the i2c-stub kernel module.
+
+ open() limits each transfer to 100 ms so a held bus cannot block a call.
+ */
+
+class BQ34Z100G1LinuxBus {
+    int fd;
+    
+public:
+    BQ34Z100G1LinuxBus(int fd = -1) : fd(fd) {}
+    
+    bool open(uint8_t adapter); // /dev/i2c-<adapter>
+    void close();
+    int descriptor() const { return fd; }
+    
+    BQ34Z100G1Status read(uint8_t device, uint8_t address, uint8_t *data, uint8_t length);
+    BQ34Z100G1Status write(uint8_t device, uint8_t address, const uint8_t *data, uint8_t length);
+    void recover();
+    
+    void delay(uint32_t ms);
+    uint32_t millis();
+    uint32_t micros();
+};
+
+#endif /* bq34z100g1_linux_hpp */
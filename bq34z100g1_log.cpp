@@ -0,0 +1,237 @@
+//
+//  bq34z100g1_log.cpp
+//  SMC
+//
+
+#include "bq34z100g1_log.hpp"
+
+const uint8_t BQ34Z100G1_LOG_VERSION = 2;
+const uint8_t BQ34Z100G1_LOG_MAX_RECORD = 1 + 6 * 5; // Mask and six varints of up to 5 bytes
+
+static uint8_t put_varint(uint8_t *out, uint32_t value) {
+    uint8_t length = 0;
+    while (value >= 0x80) {
+        out[length++] = (value & 0x7f) | 0x80;
+        value >>= 7;
+    }
+    out[length++] = value;
+    return length;
+}
+
+static uint32_t zigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+// When only voltage, current and the interval moved, and only a little, a
+// record is one byte, 10vvvccc, with the interval unchanged, or two bytes,
+// 11ttvvvvvvcccccc (big endian), all zigzag. Otherwise it is a mask byte,
+// 00xxxxxx, followed by a varint for each field whose bit is set: the
+// change in sampling interval, then the changes in voltage, current,
+// temperature and state of charge, then the flags XOR. A steady poll loop
+// with a noisy voltage and current costs one or two bytes a sample.
+uint8_t BQ34Z100G1Log::encode(const Sample &previous, uint32_t interval, const Sample &sample, uint8_t *out) {
+    uint32_t fields[6];
+    fields[0] = zigzag((int32_t)(sample.time - previous.time - interval));
+    fields[1] = zigzag((int32_t)sample.voltage - previous.voltage);
+    fields[2] = zigzag((int32_t)sample.current - previous.current);
+    fields[3] = zigzag((int32_t)sample.temperature - previous.temperature);
+    fields[4] = zigzag((int32_t)sample.state_of_charge - previous.state_of_charge);
+    fields[5] = sample.flags ^ previous.flags;
+    
+    if (!fields[3] && !fields[4] && !fields[5]) {
+        if (!fields[0] && fields[1] < 8 && fields[2] < 8) {
+            out[0] = 0x80 | fields[1] << 3 | fields[2];
+            return 1;
+        }
+        if (fields[0] < 4 && fields[1] < 64 && fields[2] < 64) {
+            out[0] = 0xc0 | fields[0] << 4 | fields[1] >> 2;
+            out[1] = (fields[1] & 0x03) << 6 | fields[2];
+            return 2;
+        }
+    }
+    
+    uint8_t length = 1;
+    out[0] = 0;
+    for (uint8_t i = 0; i < 6; i++) {
+        if (fields[i]) {
+            out[0] |= 1 << i;
+            length += put_varint(out + length, fields[i]);
+        }
+    }
+    return length;
+}
+
+BQ34Z100G1Log::Cursor::Cursor(const uint8_t *image, uint16_t length) : buffer(image), size(length), position(1), remaining(0), interval(0) {
+    memset(&state, 0, sizeof(state));
+    if (length > 0 && image[0] == BQ34Z100G1_LOG_VERSION) {
+        remaining = length - 1;
+    }
+}
+
+BQ34Z100G1Log::Cursor::Cursor(const uint8_t *buffer, uint16_t size, uint16_t position, uint16_t remaining, const Sample &state, uint32_t interval) : buffer(buffer), size(size), position(position), remaining(remaining), state(state), interval(interval) {
+}
+
+bool BQ34Z100G1Log::Cursor::read_byte(uint8_t &value) {
+    if (remaining == 0) {
+        return false;
+    }
+    value = buffer[position];
+    position = position + 1 == size ? 0 : position + 1;
+    remaining--;
+    return true;
+}
+
+bool BQ34Z100G1Log::Cursor::read_varint(uint32_t &value) {
+    value = 0;
+    for (uint8_t shift = 0; shift < 35; shift += 7) {
+        if (remaining == 0) {
+            return false;
+        }
+        uint8_t byte = buffer[position];
+        position = position + 1 == size ? 0 : position + 1;
+        remaining--;
+        value |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool BQ34Z100G1Log::Cursor::next(Sample &sample) {
+    uint8_t mask;
+    uint32_t fields[6] = {0, 0, 0, 0, 0, 0};
+    if (!read_byte(mask) || (mask & 0xc0) == 0x40) {
+        remaining = 0;
+        return false;
+    }
+    if ((mask & 0xc0) == 0x80) {
+        fields[1] = mask >> 3 & 0x07;
+        fields[2] = mask & 0x07;
+    } else if ((mask & 0xc0) == 0xc0) {
+        uint8_t low;
+        if (!read_byte(low)) {
+            remaining = 0;
+            return false;
+        }
+        fields[0] = mask >> 4 & 0x03;
+        fields[1] = (mask & 0x0f) << 2 | low >> 6;
+        fields[2] = low & 0x3f;
+    } else {
+        for (uint8_t i = 0; i < 6; i++) {
+            if ((mask & (1 << i)) && !read_varint(fields[i])) {
+                remaining = 0;
+                return false;
+            }
+        }
+    }
+    interval += unzigzag(fields[0]);
+    state.time += interval;
+    state.voltage += unzigzag(fields[1]);
+    state.current += unzigzag(fields[2]);
+    state.temperature += unzigzag(fields[3]);
+    state.state_of_charge += unzigzag(fields[4]);
+    state.flags ^= fields[5];
+    sample = state;
+    return true;
+}
+
+BQ34Z100G1Log::BQ34Z100G1Log(uint8_t *buffer, uint16_t size) : buffer(buffer), size(size) {
+    clear();
+}
+
+void BQ34Z100G1Log::clear() {
+    tail = 0;
+    used = 0;
+    records = 0;
+    memset(&base, 0, sizeof(base));
+    memset(&last, 0, sizeof(last));
+    base_interval = 0;
+    last_interval = 0;
+}
+
+void BQ34Z100G1Log::append(const Sample &sample) {
+    uint8_t record[BQ34Z100G1_LOG_MAX_RECORD];
+    uint8_t length = encode(last, last_interval, sample, record);
+    if (length > size) {
+        return;
+    }
+    Sample dropped;
+    while (size - used < length) {
+        pop(dropped);
+    }
+    
+    uint16_t head = (uint32_t)(tail + used) % size;
+    for (uint8_t i = 0; i < length; i++) {
+        buffer[head] = record[i];
+        head = head + 1 == size ? 0 : head + 1;
+    }
+    used += length;
+    records++;
+    last_interval = sample.time - last.time;
+    last = sample;
+}
+
+bool BQ34Z100G1Log::pop(Sample &sample) {
+    if (records == 0) {
+        return false;
+    }
+    Cursor oldest(buffer, size, tail, used, base, base_interval);
+    oldest.next(sample);
+    tail = oldest.position;
+    used = oldest.remaining;
+    base = sample;
+    base_interval = oldest.interval;
+    records--;
+    return true;
+}
+
+uint16_t BQ34Z100G1Log::count() const {
+    return records;
+}
+
+BQ34Z100G1Log::Cursor BQ34Z100G1Log::cursor() const {
+    return Cursor(buffer, size, tail, used, base, base_interval);
+}
+
+uint16_t BQ34Z100G1Log::export_image(uint8_t *image, uint16_t length) const {
+    if (length < 1) {
+        return 0;
+    }
+    image[0] = BQ34Z100G1_LOG_VERSION;
+    if (records == 0) {
+        return 1;
+    }
+    
+    // The two oldest records are re-encoded starting from zero, the rest
+    // copy as stored. The second has to be redone because after the first
+    // the decoder's interval is the time since zero.
+    Cursor reader = cursor();
+    Sample first;
+    reader.next(first);
+    Sample zero;
+    memset(&zero, 0, sizeof(zero));
+    uint8_t record[2 * BQ34Z100G1_LOG_MAX_RECORD];
+    uint8_t record_length = encode(zero, 0, first, record);
+    Sample second;
+    if (reader.next(second)) {
+        record_length += encode(first, first.time, second, record + record_length);
+    }
+    
+    uint32_t total = 1 + record_length + reader.remaining;
+    if (total > length) {
+        return 0;
+    }
+    memcpy(image + 1, record, record_length);
+    uint16_t position = 1 + record_length;
+    while (reader.remaining > 0) {
+        image[position++] = reader.buffer[reader.position];
+        reader.position = reader.position + 1 == size ? 0 : reader.position + 1;
+        reader.remaining--;
+    }
+    return position;
+}
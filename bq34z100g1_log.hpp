@@ -0,0 +1,78 @@
+//
+//  bq34z100g1_log.hpp
+//  SMC
+//
+
+#ifndef bq34z100g1_log_hpp
+#define bq34z100g1_log_hpp
+
+#include "bq34z100g1.hpp"
+
+/*
+ Telemetry history in a caller supplied buffer. Each sample is stored as the
+ zigzag difference from the previous one (flags as an XOR, time as the change
+ in interval): one or two bytes when only voltage and current moved a few
+ units, otherwise varints for the fields that changed. When the buffer is full the oldest samples are dropped, their
+ values folded into the base the next sample is relative to.
+
+ export_image() writes a self contained copy that a Cursor can decode on any
+ machine, see tools/bq34z100g1_log_csv.cpp.
+ */
+
+class BQ34Z100G1Log {
+public:
+    struct Sample {
+        uint32_t time; // ms
+        uint16_t voltage; // mV
+        int16_t current; // mA
+        uint16_t temperature; // Unit of x10 K
+        uint8_t state_of_charge; // 0 to 100%
+        uint16_t flags;
+    };
+    
+    class Cursor {
+    public:
+        Cursor(const uint8_t *image, uint16_t length); // From export_image()
+        bool next(Sample &sample);
+        
+    private:
+        friend class BQ34Z100G1Log;
+        
+        const uint8_t *buffer;
+        uint16_t size;
+        uint16_t position;
+        uint16_t remaining;
+        Sample state;
+        uint32_t interval; // ms between the last two samples
+        
+        Cursor(const uint8_t *buffer, uint16_t size, uint16_t position, uint16_t remaining, const Sample &state, uint32_t interval);
+        bool read_byte(uint8_t &value);
+        bool read_varint(uint32_t &value);
+    };
+    
+    BQ34Z100G1Log(uint8_t *buffer, uint16_t size);
+    
+    void append(const Sample &sample);
+    void record(BQ34Z100G1 &gauge); // One burst read of 0x02-0x11, skipped if it fails, in bq34z100g1_log_record.cpp
+    bool pop(Sample &sample); // Removes the oldest sample
+    void clear();
+    
+    uint16_t count() const;
+    Cursor cursor() const; // Oldest to newest, without removing
+    uint16_t export_image(uint8_t *image, uint16_t length) const; // 0 if it does not fit
+    
+private:
+    uint8_t *buffer;
+    uint16_t size;
+    uint16_t tail; // Oldest record
+    uint16_t used;
+    uint16_t records;
+    Sample base; // Values the oldest record is relative to
+    uint32_t base_interval;
+    Sample last;
+    uint32_t last_interval;
+    
+    static uint8_t encode(const Sample &previous, uint32_t interval, const Sample &sample, uint8_t *out);
+};
+
+#endif /* bq34z100g1_log_hpp */
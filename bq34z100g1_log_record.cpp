@@ -0,0 +1,26 @@
+//
+//  bq34z100g1_log_record.cpp
+//  SMC
+//
+//  Kept apart from bq34z100g1_log.cpp so the encoder and decoder build on a PC
+//  without the gauge.
+//
+
+#include "bq34z100g1_log.hpp"
+
+void BQ34Z100G1Log::record(BQ34Z100G1 &gauge) {
+    BQ34Z100G1Burst<BQ34Z100G1::StateOfCharge, BQ34Z100G1::Current> burst;
+    gauge.read(burst);
+    if (gauge.last_status() != BQ34Z100G1_STATUS_OK) {
+        return; // Zeros, not a sample
+    }
+    
+    Sample sample;
+    sample.time = gauge.bus.millis();
+    sample.state_of_charge = burst.get<BQ34Z100G1::StateOfCharge>();
+    sample.voltage = burst.get<BQ34Z100G1::Voltage>();
+    sample.temperature = burst.get<BQ34Z100G1::Temperature>();
+    sample.flags = burst.get<BQ34Z100G1::Flags>();
+    sample.current = burst.get<BQ34Z100G1::Current>();
+    append(sample);
+}
@@ -0,0 +1,138 @@
+//
+//  bq34z100g1_publisher.hpp
+//  SMC
+//
+
+#ifndef bq34z100g1_publisher_hpp
+#define bq34z100g1_publisher_hpp
+
+#include "bq34z100g1.hpp"
+
+#include <atomic>
+#include <string.h>
+
+/*
+ Hands the latest gauge sample from one poller task to any number of reader
+ tasks without a lock. Needs C++11 atomics, so not on AVR.
+
+ BQ34Z100G1Published keeps two buffers, each stamped with the publish it
+ holds. publish() fills the buffer readers are not pointed at, then points
+ them at it. read() copies the current buffer and checks its stamp before
+ and after, trying again only if two publishes finished during the read, so
+ successive reads never go back to an older sample. The writer never waits
+ for readers and a reader never waits for the bus or sees fields from two
+ different samples. A reader is wait-free: after read_attempts copies that
+ were all overtaken by the writer it gives up and returns false, which only
+ happens when the writer publishes faster than one copy takes.
+
+ BQ34Z100G1Publisher feeds one from BQ34Z100G1::snapshot().
+ */
+
+template <class T>
+class BQ34Z100G1Published {
+    static const uint16_t words = (sizeof(T) + 3) / 4;
+    
+    struct Buffer {
+        std::atomic<uint32_t> sequence; // Twice the publish it holds, odd while written
+        std::atomic<uint32_t> data[words];
+    };
+    
+    std::atomic<uint32_t> latest; // Last publish, 0 before the first
+    Buffer buffers[2];
+    
+public:
+    BQ34Z100G1Published() : latest(0) {
+        for (uint8_t b = 0; b < 2; b++) {
+            buffers[b].sequence.store(0, std::memory_order_relaxed);
+            for (uint16_t i = 0; i < words; i++) {
+                buffers[b].data[i].store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+    
+    // Single writer.
+    void publish(const T &value) {
+        uint32_t values[words] = {0};
+        memcpy(values, &value, sizeof(T));
+        
+        uint32_t next = latest.load(std::memory_order_relaxed) + 1;
+        if (next == 0) {
+            next = 1; // 0 means nothing published yet
+        }
+        Buffer &buffer = buffers[next & 1];
+        buffer.sequence.store(2 * next - 1, std::memory_order_relaxed);
+        for (uint16_t i = 0; i < words; i++) {
+            buffer.data[i].store(values[i], std::memory_order_release); // Seen only after the odd sequence
+        }
+        buffer.sequence.store(2 * next, std::memory_order_release);
+        latest.store(next, std::memory_order_release);
+    }
+    
+    static const uint8_t read_attempts = 4;
+    
+    // False before the first publish (count() is 0) or if the writer kept
+    // overtaking the copy; the caller may try again later.
+    bool read(T &value) const {
+        uint32_t values[words];
+        for (uint8_t attempt = 0; attempt < read_attempts; attempt++) {
+            uint32_t current = latest.load(std::memory_order_acquire);
+            if (current == 0) {
+                return false;
+            }
+            const Buffer &buffer = buffers[current & 1];
+            uint32_t sequence = buffer.sequence.load(std::memory_order_acquire);
+            if (sequence != 2 * current) {
+                continue; // Lapped by the writer
+            }
+            for (uint16_t i = 0; i < words; i++) {
+                values[i] = buffer.data[i].load(std::memory_order_acquire);
+            }
+            if (buffer.sequence.load(std::memory_order_relaxed) == sequence) {
+                memcpy(&value, values, sizeof(T));
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    uint32_t count() const {
+        return latest.load(std::memory_order_acquire);
+    }
+};
+
+class BQ34Z100G1Publisher {
+public:
+    struct Sample {
+        BQ34Z100G1::Snapshot snapshot;
+        uint32_t time; // millis() of the read
+        BQ34Z100G1Status status; // Of the read
+        bool consistent; // From BQ34Z100G1::snapshot()
+    };
+    
+    BQ34Z100G1Publisher(BQ34Z100G1 &gauge) : gauge(gauge) {}
+    
+    // From the poller task only. Failed reads are published too, check status.
+    bool poll() {
+        Sample sample;
+        sample.consistent = gauge.snapshot(sample.snapshot);
+        sample.status = gauge.last_status();
+        sample.time = gauge.bus.millis();
+        published.publish(sample);
+        return sample.consistent;
+    }
+    
+    // From any task.
+    bool read(Sample &sample) const {
+        return published.read(sample);
+    }
+    
+    uint32_t count() const {
+        return published.count();
+    }
+    
+private:
+    BQ34Z100G1 &gauge;
+    BQ34Z100G1Published<Sample> published;
+};
+
+#endif /* bq34z100g1_publisher_hpp */
@@ -0,0 +1,140 @@
+//
+//  bq34z100g1_registers.hpp
+//  SMC
+//
+
+#ifndef bq34z100g1_registers_hpp
+#define bq34z100g1_registers_hpp
+
+#include <stdint.h>
+
+/*
+ Compile time descriptions of the standard and extended commands. Everything
+ here folds to constants; nothing is looked up at run time.
+
+ BQ34Z100G1Register<address, type, unit, scale, divisor> describes one
+ command, its value in unit being raw * scale / divisor.
+
+ BQ34Z100G1Burst<Registers...> covers the smallest address range holding all
+ of the given registers, for reading them in one transaction and decoding
+ each with get<Register>().
+
+ BQ34Z100G1Parameter<sub_class, offset, type, minimum, maximum> describes one
+ data flash parameter. Offsets count from the start of the subclass and data
+ flash values are big endian. 32 bit parameters are raw and not range checked.
+ */
+
+enum BQ34Z100G1Unit {
+    BQ34Z100G1_UNIT_NONE,
+    BQ34Z100G1_UNIT_PERCENT,
+    BQ34Z100G1_UNIT_MAH,
+    BQ34Z100G1_UNIT_MV,
+    BQ34Z100G1_UNIT_MA,
+    BQ34Z100G1_UNIT_KELVIN,
+    BQ34Z100G1_UNIT_MWH,
+    BQ34Z100G1_UNIT_MW,
+    BQ34Z100G1_UNIT_SECONDS,
+    BQ34Z100G1_UNIT_MINUTES
+};
+
+// Flags() bits, also the bits of the Alert Configuration mask.
+enum BQ34Z100G1Flag {
+    BQ34Z100G1_FLAG_DSG = 0x0001, // Discharging
+    BQ34Z100G1_FLAG_SOCF = 0x0002, // State of charge final threshold
+    BQ34Z100G1_FLAG_SOC1 = 0x0004, // State of charge threshold 1
+    BQ34Z100G1_FLAG_HW0 = 0x0008,
+    BQ34Z100G1_FLAG_HW1 = 0x0010,
+    BQ34Z100G1_FLAG_TDD = 0x0020, // Tab disconnect detected
+    BQ34Z100G1_FLAG_ISD = 0x0040, // Internal short detected
+    BQ34Z100G1_FLAG_OCVTAKEN = 0x0080,
+    BQ34Z100G1_FLAG_CHG = 0x0100, // Fast charging allowed
+    BQ34Z100G1_FLAG_FC = 0x0200, // Full charge
+    BQ34Z100G1_FLAG_XCHG = 0x0400, // Charge suspended
+    BQ34Z100G1_FLAG_CHG_INH = 0x0800, // Charge inhibited by temperature
+    BQ34Z100G1_FLAG_BATLOW = 0x1000, // Battery low voltage
+    BQ34Z100G1_FLAG_BATHI = 0x2000, // Battery high voltage
+    BQ34Z100G1_FLAG_OTD = 0x4000, // Over temperature in discharge
+    BQ34Z100G1_FLAG_OTC = 0x8000 // Over temperature in charge
+};
+
+template <uint8_t Address, typename Type, BQ34Z100G1Unit Unit = BQ34Z100G1_UNIT_NONE, uint8_t Scale = 1, uint8_t Divisor = 1>
+struct BQ34Z100G1Register {
+    typedef Type type;
+    static const uint8_t address = Address;
+    static const uint8_t length = sizeof(Type);
+    static const BQ34Z100G1Unit unit = Unit;
+    
+    static Type decode(const uint8_t *data) {
+        return length == 1 ? (Type)data[0] : (Type)(data[0] | (data[1] << 8));
+    }
+    
+    static float convert(Type raw) {
+        return (float)raw * Scale / Divisor;
+    }
+};
+
+template <class Register>
+constexpr uint8_t bq34z100g1_first_address() {
+    return Register::address;
+}
+
+template <class Register, class Next, class... Rest>
+constexpr uint8_t bq34z100g1_first_address() {
+    return Register::address < bq34z100g1_first_address<Next, Rest...>() ? Register::address : bq34z100g1_first_address<Next, Rest...>();
+}
+
+template <class Register>
+constexpr uint8_t bq34z100g1_end_address() {
+    return Register::address + Register::length;
+}
+
+template <class Register, class Next, class... Rest>
+constexpr uint8_t bq34z100g1_end_address() {
+    return Register::address + Register::length > bq34z100g1_end_address<Next, Rest...>() ? Register::address + Register::length : bq34z100g1_end_address<Next, Rest...>();
+}
+
+template <class... Registers>
+struct BQ34Z100G1Burst {
+    static const uint8_t address = bq34z100g1_first_address<Registers...>();
+    static const uint8_t length = bq34z100g1_end_address<Registers...>() - address;
+    
+    uint8_t data[length];
+    
+    template <class Register>
+    typename Register::type get() const {
+        static_assert(Register::address >= address && Register::address + Register::length <= address + length, "Register outside the burst");
+        return Register::decode(data + Register::address - address);
+    }
+};
+
+template <uint8_t SubClass, uint8_t Offset, typename Type, int32_t Minimum, int32_t Maximum>
+struct BQ34Z100G1Parameter {
+    typedef Type type;
+    static const uint8_t sub_class = SubClass;
+    static const uint8_t offset = Offset;
+    static const uint8_t length = sizeof(Type);
+    
+    static_assert(Offset % 32 + sizeof(Type) <= 32, "Parameter crosses a data flash block");
+    
+    static bool valid(Type value) {
+        return length == 4 || ((int32_t)value >= Minimum && (int32_t)value <= Maximum);
+    }
+    
+    static Type decode(const uint8_t *data) {
+        uint32_t raw = 0;
+        for (uint8_t i = 0; i < length; i++) {
+            raw = (raw << 8) | data[i];
+        }
+        return (Type)raw;
+    }
+    
+    static void encode(Type value, uint8_t *data) {
+        uint32_t raw = (uint32_t)value;
+        for (uint8_t i = length; i > 0; i--) {
+            data[i - 1] = raw & 0xff;
+            raw >>= 8;
+        }
+    }
+};
+
+#endif /* bq34z100g1_registers_hpp */
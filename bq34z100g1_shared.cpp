@@ -0,0 +1,183 @@
+//
+//  bq34z100g1_shared.cpp
+//  SMC
+//
+
+#if !defined(ARDUINO) && defined(__linux__)
+
+#include "bq34z100g1_shared.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if ATOMIC_INT_LOCK_FREE != 2
+#error "Shared samples need lock free 32 bit atomics"
+#endif
+
+static const uint16_t segment_version = 1;
+static const uint16_t read_attempts = 1000;
+
+// Opens the segment locked for writing. -1 with errno EBUSY if another
+// writer holds it.
+static int open_locked(const char *name, int flags) {
+    int fd = shm_open(name, O_RDWR | O_CREAT | flags, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        ::close(fd);
+        errno = EBUSY;
+        return -1;
+    }
+    return fd;
+}
+
+bool BQ34Z100G1SharedWriter::create(uint8_t count, const char *name) {
+    close();
+    if (count > BQ34Z100G1_SHARED_GAUGES || strlen(name) >= sizeof(this->name)) {
+        errno = EINVAL;
+        return false;
+    }
+    int fd = open_locked(name, 0);
+    if (fd < 0) {
+        return false;
+    }
+    
+    // A segment left by a writer that died is taken over in place, so its
+    // readers keep working. Anything else is replaced rather than resized,
+    // since shrinking a mapped segment kills its readers with SIGBUS.
+    struct stat info;
+    off_t size = fstat(fd, &info) == 0 ? info.st_size : 0;
+    void *memory = MAP_FAILED;
+    if (size == sizeof(BQ34Z100G1SharedSegment)) {
+        memory = mmap(0, sizeof(BQ34Z100G1SharedSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        const BQ34Z100G1SharedSegment *existing = (const BQ34Z100G1SharedSegment *)memory;
+        if (memory != MAP_FAILED && (existing->magic != BQ34Z100G1SharedSegment::magic_value || existing->version != segment_version)) {
+            munmap(memory, sizeof(BQ34Z100G1SharedSegment));
+            memory = MAP_FAILED;
+        }
+    }
+    if (memory == MAP_FAILED) {
+        if (size != 0) {
+            shm_unlink(name);
+            ::close(fd);
+            if ((fd = open_locked(name, O_EXCL)) < 0) {
+                return false;
+            }
+        }
+        if (ftruncate(fd, sizeof(BQ34Z100G1SharedSegment)) == 0) {
+            memory = mmap(0, sizeof(BQ34Z100G1SharedSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        if (memory == MAP_FAILED) {
+            shm_unlink(name);
+            ::close(fd);
+            return false;
+        }
+    }
+    
+    segment = (BQ34Z100G1SharedSegment *)memory; // Zero filled by ftruncate, or the last writer's
+    segment->version = segment_version;
+    segment->count = count;
+    std::atomic_thread_fence(std::memory_order_release);
+    segment->magic = BQ34Z100G1SharedSegment::magic_value; // Readers check this last
+    this->fd = fd; // Holds the lock
+    strcpy(this->name, name);
+    return true;
+}
+
+void BQ34Z100G1SharedWriter::close() {
+    if (!segment) {
+        return;
+    }
+    munmap(segment, sizeof(BQ34Z100G1SharedSegment));
+    shm_unlink(name);
+    ::close(fd);
+    segment = 0;
+    fd = -1;
+}
+
+void BQ34Z100G1SharedWriter::publish(uint8_t index, const BQ34Z100G1SharedSample &sample) {
+    if (!segment || index >= segment->count) {
+        return;
+    }
+    uint32_t words[BQ34Z100G1SharedSegment::words] = {0};
+    memcpy(words, &sample, sizeof(sample));
+    
+    BQ34Z100G1SharedSegment::Slot &slot = segment->slots[index];
+    uint32_t sequence = slot.sequence.load(std::memory_order_relaxed) & ~1UL; // Odd if the last writer died mid-update
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (uint16_t i = 0; i < BQ34Z100G1SharedSegment::words; i++) {
+        slot.data[i].store(words[i], std::memory_order_relaxed);
+    }
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool BQ34Z100G1SharedReader::open(const char *name) {
+    close();
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+    void *memory = MAP_FAILED;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size == sizeof(BQ34Z100G1SharedSegment)) {
+        memory = mmap(0, sizeof(BQ34Z100G1SharedSegment), PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        return false;
+    }
+    segment = (const BQ34Z100G1SharedSegment *)memory;
+    if (segment->magic != BQ34Z100G1SharedSegment::magic_value || segment->version != segment_version) {
+        close(); // Not created yet, or by another version
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return true;
+}
+
+void BQ34Z100G1SharedReader::close() {
+    if (!segment) {
+        return;
+    }
+    munmap((void *)segment, sizeof(BQ34Z100G1SharedSegment));
+    segment = 0;
+}
+
+uint8_t BQ34Z100G1SharedReader::size() const {
+    return segment ? segment->count : 0;
+}
+
+bool BQ34Z100G1SharedReader::read(uint8_t index, BQ34Z100G1SharedSample &sample) const {
+    if (!segment || index >= segment->count) {
+        return false;
+    }
+    const BQ34Z100G1SharedSegment::Slot &slot = segment->slots[index];
+    uint32_t words[BQ34Z100G1SharedSegment::words];
+    for (uint16_t attempt = 0; attempt < read_attempts; attempt++) {
+        uint32_t before = slot.sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            continue; // Being written
+        }
+        for (uint16_t i = 0; i < BQ34Z100G1SharedSegment::words; i++) {
+            words[i] = slot.data[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) == before) {
+            if (before == 0) {
+                return false;
+            }
+            memcpy(&sample, words, sizeof(sample));
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif
@@ -0,0 +1,87 @@
+//
+//  bq34z100g1_shared.hpp
+//  SMC
+//
+
+#ifndef bq34z100g1_shared_hpp
+#define bq34z100g1_shared_hpp
+
+#if !defined(ARDUINO) && defined(__linux__)
+
+#include "bq34z100g1.hpp"
+
+#include <atomic>
+
+#define BQ34Z100G1_SHARED_NAME "/bq34z100g1"
+#define BQ34Z100G1_SHARED_GAUGES 16
+
+/*
+ Latest sample per gauge in a POSIX shared memory segment, written by one
+ process (tools/bq34z100g1_daemon.cpp) and read by any number of others.
+
+ Each slot is a seqlock: the writer makes the sequence odd, stores the
+ sample and makes it even again. A reader copies the sample between two
+ loads of the sequence and retries if they differ, so it never blocks the
+ writer, never enters the kernel and never sees half a sample.
+
+ The writer holds an exclusive flock() on the segment, so a second writer
+ fails with EBUSY instead of truncating the segment under its readers. A
+ segment left behind by a writer that died is taken over as it is.
+ */
+
+struct BQ34Z100G1SharedSample {
+    uint64_t time; // ms, CLOCK_MONOTONIC of the writer
+    BQ34Z100G1::Snapshot snapshot;
+    uint8_t status; // BQ34Z100G1Status of the read
+    uint8_t consistent; // From BQ34Z100G1::snapshot()
+};
+
+struct BQ34Z100G1SharedSegment {
+    static const uint32_t magic_value = 0x42515a31; // "BQZ1"
+    static const uint16_t words = (sizeof(BQ34Z100G1SharedSample) + 3) / 4;
+    
+    struct Slot {
+        std::atomic<uint32_t> sequence; // Odd while written, 0 until first sample
+        std::atomic<uint32_t> data[words];
+    };
+    
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    Slot slots[BQ34Z100G1_SHARED_GAUGES];
+};
+
+class BQ34Z100G1SharedWriter {
+    BQ34Z100G1SharedSegment *segment;
+    int fd;
+    char name[32];
+    
+public:
+    BQ34Z100G1SharedWriter() : segment(0), fd(-1) { name[0] = 0; }
+    ~BQ34Z100G1SharedWriter() { close(); }
+    
+    // False with errno set, EBUSY if another writer has the segment.
+    bool create(uint8_t count, const char *name = BQ34Z100G1_SHARED_NAME);
+    void close(); // Also removes the segment
+    
+    void publish(uint8_t index, const BQ34Z100G1SharedSample &sample);
+};
+
+class BQ34Z100G1SharedReader {
+    const BQ34Z100G1SharedSegment *segment;
+    
+public:
+    BQ34Z100G1SharedReader() : segment(0) {}
+    ~BQ34Z100G1SharedReader() { close(); }
+    
+    bool open(const char *name = BQ34Z100G1_SHARED_NAME);
+    void close();
+    uint8_t size() const;
+    
+    // False before the first sample or while the writer is stuck mid-update.
+    bool read(uint8_t index, BQ34Z100G1SharedSample &sample) const;
+};
+
+#endif
+
+#endif /* bq34z100g1_shared_hpp */
@@ -0,0 +1,124 @@
+//
+//  bq34z100g1_stats.hpp
+//  SMC
+//
+
+#ifndef bq34z100g1_stats_hpp
+#define bq34z100g1_stats_hpp
+
+#include <stdint.h>
+#include <string.h>
+
+#include "bq34z100g1_status.hpp"
+
+#ifndef BQ34Z100G1_STATS_METHODS
+#define BQ34Z100G1_STATS_METHODS 16 // About 80 bytes of RAM each
+#endif
+
+/*
+ Bus accounting, only built when BQ34Z100G1_STATS is defined. The gauge then
+ holds its bus as a BQ34Z100G1StatsBus, which counts every read() and write()
+ against the outermost public method in progress. Entry 0 collects traffic
+ outside any instrumented method and, once the table is full, everything else.
+
+ Latency is the duration of each call to the method from bus.micros(),
+ counted in power of two buckets: under 32 us, 32-63 us, 64-127 us, ... and
+ 0.5 s or more. The bus only needs micros() when statistics are enabled.
+ */
+
+struct BQ34Z100G1Stats {
+    static const uint8_t buckets = 16;
+    
+    struct Method {
+        const char *name; // 0 for entry 0
+        uint32_t calls;
+        uint32_t transactions;
+        uint32_t bytes;
+        uint32_t failures; // NACK or short read
+        uint32_t latency[buckets];
+    };
+    
+    Method methods[BQ34Z100G1_STATS_METHODS];
+    Method *current; // Method the bus traffic is counted against
+    
+    BQ34Z100G1Stats() {
+        clear();
+    }
+    
+    void clear() {
+        memset(methods, 0, sizeof(methods));
+        current = methods;
+    }
+    
+    Method *find(const char *name) {
+        for (uint8_t n = 1; n < BQ34Z100G1_STATS_METHODS; n++) {
+            if (methods[n].name == name || !methods[n].name) {
+                methods[n].name = name;
+                return &methods[n];
+            }
+        }
+        return methods;
+    }
+    
+    void count(uint8_t length, BQ34Z100G1Status status) {
+        current->transactions++;
+        current->bytes += length;
+        current->failures += status != BQ34Z100G1_STATUS_OK;
+    }
+    
+    void record(Method *method, uint32_t elapsed) { // us
+        uint8_t bucket = 0;
+        elapsed >>= 5;
+        while (elapsed > 0 && bucket < buckets - 1) {
+            elapsed >>= 1;
+            bucket++;
+        }
+        method->calls++;
+        method->latency[bucket]++;
+    }
+};
+
+template <class Bus>
+class BQ34Z100G1StatsBus : public Bus {
+public:
+    BQ34Z100G1Stats stats;
+    
+    BQ34Z100G1StatsBus(const Bus &bus) : Bus(bus) {}
+    
+    BQ34Z100G1Status read(uint8_t device, uint8_t address, uint8_t *data, uint8_t length) {
+        BQ34Z100G1Status status = Bus::read(device, address, data, length);
+        stats.count(length, status);
+        return status;
+    }
+    
+    BQ34Z100G1Status write(uint8_t device, uint8_t address, const uint8_t *data, uint8_t length) {
+        BQ34Z100G1Status status = Bus::write(device, address, data, length);
+        stats.count(length, status);
+        return status;
+    }
+    
+    // Attributes traffic to name for its lifetime unless an outer Scope is open.
+    class Scope {
+        BQ34Z100G1StatsBus &bus;
+        BQ34Z100G1Stats::Method *method;
+        uint32_t start;
+        
+    public:
+        Scope(BQ34Z100G1StatsBus &bus, const char *name) : bus(bus), method(0), start(0) {
+            if (bus.stats.current == bus.stats.methods) {
+                method = bus.stats.find(name);
+                bus.stats.current = method;
+                start = bus.micros();
+            }
+        }
+        
+        ~Scope() {
+            if (method) {
+                bus.stats.record(method, bus.micros() - start);
+                bus.stats.current = bus.stats.methods;
+            }
+        }
+    };
+};
+
+#endif /* bq34z100g1_stats_hpp */
@@ -0,0 +1,18 @@
+//
+//  bq34z100g1_status.hpp
+//  SMC
+//
+
+#ifndef bq34z100g1_status_hpp
+#define bq34z100g1_status_hpp
+
+// Outcome of a bus transfer or of a whole BQ34Z100G1 call, see last_status().
+enum BQ34Z100G1Status {
+    BQ34Z100G1_STATUS_OK,
+    BQ34Z100G1_STATUS_NACK, // Address or data not acknowledged
+    BQ34Z100G1_STATUS_SHORT_READ, // Fewer bytes than requested
+    BQ34Z100G1_STATUS_TIMEOUT, // Bus held, or the call ran past its deadline
+    BQ34Z100G1_STATUS_CHECKSUM // Data flash write not accepted or not read back
+};
+
+#endif /* bq34z100g1_status_hpp */
@@ -0,0 +1,285 @@
+//
+//  bq34z100g1_stream.cpp
+//  SMC
+//
+
+#include "bq34z100g1_stream.hpp"
+
+#if BQ34Z100G1_STREAM_BUFFER > 255
+#error "BQ34Z100G1_STREAM_BUFFER must fit a single bus transfer"
+#endif
+
+static const uint8_t merge_first = 0x40; // Block data
+static const uint8_t merge_end = 0x60; // Block checksum, never merged
+
+BQ34Z100G1FlashStream::BQ34Z100G1FlashStream(BQ34Z100G1 &gauge) : gauge(gauge), outcome(OK), line_number(1), transaction_count(0), command(0), colon(false), comment(false), field(0), value(0), digits(0), device(0), address(0), count(0), wait(0), length(0), pending(false), pending_device(0), pending_address(0), line_start(0), checksum_written(false), checksum(0) {
+}
+
+bool BQ34Z100G1FlashStream::feed(char c) {
+    if (outcome != OK) {
+        return false;
+    }
+    if (c == '\n') {
+        end_line();
+        if (outcome == OK) {
+            line_number++;
+        }
+        return outcome == OK;
+    }
+    if (comment) {
+        return true;
+    }
+    if (c == ';') {
+        end_value();
+        comment = true;
+    } else if (c == ' ' || c == '\t' || c == '\r') {
+        end_value();
+    } else if (!command) {
+        c &= ~0x20; // Upper case
+        if (c != 'W' && c != 'R' && c != 'C' && c != 'X') {
+            fail(SYNTAX);
+        } else {
+            command = c;
+            if (command != 'W') {
+                flush(); // Keep the file's order
+            }
+        }
+    } else if (!colon) {
+        if (c == ':') {
+            colon = true;
+        } else {
+            fail(SYNTAX);
+        }
+    } else {
+        uint8_t digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f' && command != 'X') {
+            digit = (c | 0x20) - 'a' + 10;
+        } else {
+            fail(SYNTAX);
+            return false;
+        }
+        value = value * (command == 'X' ? 10 : 16) + digit;
+        if (++digits > (command == 'X' ? 7 : 2)) {
+            fail(SYNTAX);
+        }
+    }
+    return outcome == OK;
+}
+
+bool BQ34Z100G1FlashStream::feed(const char *text, uint16_t length) {
+    for (uint16_t i = 0; i < length; i++) {
+        if (!feed(text[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BQ34Z100G1FlashStream::finish() {
+    if (outcome == OK) {
+        end_line();
+    }
+    if (outcome == OK) {
+        flush();
+    }
+    // The stream may have changed data flash, the seal state or the firmware.
+    gauge.invalidate_flash_cache();
+    gauge.invalidate_identity();
+    return outcome == OK;
+}
+
+BQ34Z100G1FlashStream::Result BQ34Z100G1FlashStream::result() const {
+    return outcome;
+}
+
+uint32_t BQ34Z100G1FlashStream::line() const {
+    return line_number;
+}
+
+uint32_t BQ34Z100G1FlashStream::transactions() const {
+    return transaction_count;
+}
+
+void BQ34Z100G1FlashStream::fail(Result result) {
+    if (outcome == OK) {
+        outcome = result;
+    }
+}
+
+void BQ34Z100G1FlashStream::end_value() {
+    if (!digits || outcome != OK) {
+        return;
+    }
+    uint8_t byte = value;
+    if (command == 'X') {
+        if (field > 0) {
+            fail(SYNTAX);
+        }
+        wait = value;
+    } else if (field == 0) {
+        if (byte & 1) {
+            fail(SYNTAX); // Files give the 8 bit write address
+        }
+        device = byte >> 1;
+    } else if (field == 1) {
+        address = byte;
+        if (command == 'W') {
+            bool follows = pending && device == pending_device && address == pending_address + length;
+            if (!follows || pending_address < merge_first || address >= merge_end) {
+                flush();
+            }
+            if (!pending) {
+                pending = true;
+                pending_device = device;
+                pending_address = address;
+            }
+            line_start = length;
+        } else {
+            length = 0;
+        }
+    } else if (command == 'R') {
+        if (field > 2) {
+            fail(SYNTAX);
+        } else if (byte > sizeof(buffer)) {
+            fail(TOO_LONG);
+        }
+        count = byte;
+    } else {
+        if (length == sizeof(buffer)) {
+            split();
+        }
+        if (length == sizeof(buffer)) {
+            fail(TOO_LONG);
+        } else {
+            buffer[length++] = byte;
+        }
+    }
+    field++;
+    value = 0;
+    digits = 0;
+}
+
+void BQ34Z100G1FlashStream::end_line() {
+    end_value();
+    if (outcome == OK && command) {
+        if (!colon) {
+            fail(SYNTAX);
+        } else if (command == 'W') {
+            if (field < 3) {
+                fail(SYNTAX);
+            } else if (pending_address + length > merge_end) {
+                split(); // Only the last line may run past the window
+            }
+        } else if (command == 'R') {
+            if (field != 3) {
+                fail(SYNTAX);
+            } else {
+                read(device, address, buffer, count);
+            }
+        } else if (command == 'C') {
+            if (field < 3) {
+                fail(SYNTAX);
+            } else {
+                compare();
+            }
+        } else if (field != 1) {
+            fail(SYNTAX);
+        } else {
+            delay();
+        }
+    }
+    command = 0;
+    colon = false;
+    comment = false;
+    field = 0;
+    value = 0;
+    digits = 0;
+}
+
+void BQ34Z100G1FlashStream::flush() {
+    if (!pending) {
+        return;
+    }
+    write(pending_device, pending_address, buffer, length);
+    pending = false;
+    length = 0;
+    line_start = 0;
+}
+
+// Sends the lines held before this one on their own.
+void BQ34Z100G1FlashStream::split() {
+    if (!pending || line_start == 0) {
+        return;
+    }
+    write(pending_device, pending_address, buffer, line_start);
+    memmove(buffer, buffer + line_start, length - line_start);
+    length -= line_start;
+    pending_address += line_start;
+    line_start = 0;
+}
+
+bool BQ34Z100G1FlashStream::write(uint8_t device, uint8_t address, const uint8_t *data, uint8_t length) {
+    if (outcome != OK) {
+        return false;
+    }
+    BQ34Z100G1_OPERATION(gauge);
+    transaction_count++;
+    BQ34Z100G1Status status;
+    if (device == gauge.device) {
+        status = gauge.write_block(address, data, length);
+    } else if ((status = gauge.bus.write(device, address, data, length)) != BQ34Z100G1_STATUS_OK) {
+        gauge.failed(status);
+    }
+    if (status != BQ34Z100G1_STATUS_OK) {
+        fail(TRANSFER);
+        return false;
+    }
+    checksum_written = device == gauge.device && address <= merge_end && address + length > merge_end;
+    if (checksum_written) {
+        checksum = data[merge_end - address];
+    }
+    return true;
+}
+
+bool BQ34Z100G1FlashStream::read(uint8_t device, uint8_t address, uint8_t *data, uint8_t length) {
+    BQ34Z100G1_OPERATION(gauge);
+    transaction_count++;
+    checksum_written = false;
+    BQ34Z100G1Status status;
+    if (device == gauge.device) {
+        status = gauge.read_block(address, data, length);
+    } else if ((status = gauge.bus.read(device, address, data, length)) != BQ34Z100G1_STATUS_OK) {
+        gauge.failed(status);
+    }
+    if (status != BQ34Z100G1_STATUS_OK) {
+        fail(TRANSFER);
+        return false;
+    }
+    return true;
+}
+
+void BQ34Z100G1FlashStream::compare() {
+    uint8_t data[BQ34Z100G1_STREAM_BUFFER];
+    if (read(device, address, data, length) && memcmp(data, buffer, length) != 0) {
+        fail(MISMATCH);
+    }
+    length = 0;
+}
+
+void BQ34Z100G1FlashStream::delay() {
+    BQ34Z100G1_OPERATION(gauge);
+    if (!checksum_written) {
+        gauge.bus.delay(wait);
+        return;
+    }
+    checksum_written = false;
+    uint32_t start = gauge.bus.millis();
+    if (!gauge.wait_flash_write(checksum)) {
+        uint32_t elapsed = gauge.bus.millis() - start;
+        if (elapsed < wait) {
+            gauge.bus.delay(wait - elapsed); // Give it the time the file asked for
+        }
+    }
+}
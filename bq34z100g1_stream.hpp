@@ -0,0 +1,89 @@
+//
+//  bq34z100g1_stream.hpp
+//  SMC
+//
+
+#ifndef bq34z100g1_stream_hpp
+#define bq34z100g1_stream_hpp
+
+#include "bq34z100g1.hpp"
+
+#ifndef BQ34Z100G1_STREAM_BUFFER
+#define BQ34Z100G1_STREAM_BUFFER 128 // Longest W or C line, in bytes
+#endif
+
+/*
+ Runs TI flash stream files (.bq.fs, .df.fs) as they are read, one character
+ at a time, in constant memory.
+
+     W: AA 3E 02 00    write bytes from register 3E, device 0xAA >> 1
+     R: AA 40 20       read 0x20 bytes
+     C: AA 60 5C       read and compare
+     X: 200            wait 200 ms
+     ; comment
+
+ Writes to consecutive registers of the block data (40 to 5F) on consecutive
+ W lines go out as one transaction. An X after a block
+ checksum write polls for the flash write to finish, as the update_* calls
+ do, instead of always waiting the full time. Lines are never split, so a
+ line longer than BQ34Z100G1_STREAM_BUFFER bytes is an error.
+
+ Writes for the gauge's own address get its retry policy. Other addresses,
+ such as ROM mode at 0x16, go straight to the bus.
+ */
+
+class BQ34Z100G1FlashStream {
+public:
+    enum Result { OK, SYNTAX, TOO_LONG, TRANSFER, MISMATCH };
+    
+    BQ34Z100G1FlashStream(BQ34Z100G1 &gauge);
+    
+    // Both return false once the stream has failed; later input is ignored.
+    bool feed(char c);
+    bool feed(const char *text, uint16_t length);
+    // Runs a last line without a newline and sends any held write.
+    bool finish();
+    
+    Result result() const;
+    uint32_t line() const; // Of the failure, or lines so far
+    uint32_t transactions() const;
+    
+private:
+    BQ34Z100G1 &gauge;
+    Result outcome;
+    uint32_t line_number;
+    uint32_t transaction_count;
+    
+    char command; // 0 until the line's W, R, C or X
+    bool colon;
+    bool comment;
+    uint8_t field; // Values finished on this line
+    uint32_t value;
+    uint8_t digits;
+    
+    uint8_t device; // 7 bit address of this line
+    uint8_t address; // Register of this line
+    uint8_t count; // Bytes to read on an R line
+    uint32_t wait; // ms on an X line
+    
+    uint8_t buffer[BQ34Z100G1_STREAM_BUFFER];
+    uint16_t length;
+    bool pending; // buffer holds writes not sent yet
+    uint8_t pending_device;
+    uint8_t pending_address;
+    uint16_t line_start; // This line's first byte in buffer
+    bool checksum_written; // Last write ended a flash block update
+    uint8_t checksum;
+    
+    void fail(Result result);
+    void end_value();
+    void end_line();
+    void flush();
+    void split();
+    bool write(uint8_t device, uint8_t address, const uint8_t *data, uint8_t length);
+    bool read(uint8_t device, uint8_t address, uint8_t *data, uint8_t length);
+    void compare();
+    void delay();
+};
+
+#endif /* bq34z100g1_stream_hpp */
@@ -0,0 +1,127 @@
+//
+//  bq34z100g1_wire.hpp
+//  SMC
+//
+
+#ifndef bq34z100g1_wire_hpp
+#define bq34z100g1_wire_hpp
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#include "bq34z100g1_status.hpp"
+
+/*
+ Bus transport used by BQ34Z100G1. Any class with the same members can be
+ selected at compile time by defining BQ34Z100G1_BUS and BQ34Z100G1_BUS_HEADER.
+
+ read() and write() transfer length bytes starting at a register address and
+ return the first failure. recover() frees a bus held by a device stuck
+ mid-byte: up to nine SCL pulses until SDA is released, then a STOP.
+
+ Where the core supports it, a transfer gives up after 25 ms instead of
+ waiting on a held bus forever.
+ */
+
+class BQ34Z100G1WireBus {
+    TwoWire *wire;
+    uint8_t sda;
+    uint8_t scl;
+
+    static const uint8_t buffer_length = 32; // Wire buffer size on AVR
+
+    static BQ34Z100G1Status transmission_status(uint8_t result) {
+        switch (result) {
+            case 0: return BQ34Z100G1_STATUS_OK;
+            case 4: // Other error, usually a held bus
+            case 5: return BQ34Z100G1_STATUS_TIMEOUT;
+            default: return BQ34Z100G1_STATUS_NACK;
+        }
+    }
+
+public:
+    BQ34Z100G1WireBus(TwoWire &wire = Wire, uint8_t sda = SDA, uint8_t scl = SCL) : wire(&wire), sda(sda), scl(scl) {
+#ifdef WIRE_HAS_TIMEOUT
+        wire.setWireTimeout(25000, true);
+#endif
+    }
+
+    BQ34Z100G1Status read(uint8_t device, uint8_t address, uint8_t *data, uint8_t length) {
+        while (length > 0) {
+            uint8_t chunk = length < buffer_length ? length : buffer_length;
+            wire->beginTransmission(device);
+            wire->write(address);
+            BQ34Z100G1Status status = transmission_status(wire->endTransmission(false));
+            if (status != BQ34Z100G1_STATUS_OK) {
+                return status;
+            }
+            uint8_t received = wire->requestFrom(device, chunk, (uint8_t)true);
+            for (uint8_t i = 0; i < received; i++) {
+                data[i] = wire->read();
+            }
+            if (received != chunk) {
+                return received == 0 ? BQ34Z100G1_STATUS_NACK : BQ34Z100G1_STATUS_SHORT_READ;
+            }
+            address += chunk;
+            data += chunk;
+            length -= chunk;
+        }
+        return BQ34Z100G1_STATUS_OK;
+    }
+
+    BQ34Z100G1Status write(uint8_t device, uint8_t address, const uint8_t *data, uint8_t length) {
+        do {
+            uint8_t chunk = length < buffer_length - 1 ? length : buffer_length - 1;
+            wire->beginTransmission(device);
+            wire->write(address);
+            for (uint8_t i = 0; i < chunk; i++) {
+                wire->write(data[i]);
+            }
+            BQ34Z100G1Status status = transmission_status(wire->endTransmission(true));
+            if (status != BQ34Z100G1_STATUS_OK) {
+                return status;
+            }
+            address += chunk;
+            data += chunk;
+            length -= chunk;
+        } while (length > 0);
+        return BQ34Z100G1_STATUS_OK;
+    }
+
+    void recover() {
+        wire->end();
+        // Open drain by hand: OUTPUT LOW pulls a line down, INPUT_PULLUP releases it.
+        pinMode(sda, INPUT_PULLUP);
+        pinMode(scl, INPUT_PULLUP);
+        for (uint8_t i = 0; i < 9 && digitalRead(sda) == LOW; i++) {
+            digitalWrite(scl, LOW);
+            pinMode(scl, OUTPUT);
+            delayMicroseconds(5);
+            pinMode(scl, INPUT_PULLUP);
+            delayMicroseconds(5);
+        }
+        digitalWrite(sda, LOW); // STOP: SDA rises while SCL is high
+        pinMode(sda, OUTPUT);
+        delayMicroseconds(5);
+        pinMode(sda, INPUT_PULLUP);
+        delayMicroseconds(5);
+        wire->begin();
+#ifdef WIRE_HAS_TIMEOUT
+        wire->clearWireTimeoutFlag();
+#endif
+    }
+
+    void delay(uint32_t ms) {
+        ::delay(ms);
+    }
+
+    uint32_t millis() {
+        return ::millis();
+    }
+
+    uint32_t micros() {
+        return ::micros();
+    }
+};
+
+#endif /* bq34z100g1_wire_hpp */
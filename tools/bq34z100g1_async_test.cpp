@@ -0,0 +1,118 @@
+//
+//  bq34z100g1_async_test.cpp
+//  SMC
+//
+//  Drives BQ34Z100G1AsyncReader through BQ34Z100G1SimulatedTransport on
+//  BQ34Z100G1Model and checks that requests finish in queue order with the
+//  right values, that a request waits while the driver is busy with another
+//  transfer, and that a NACK reaches the callback. Exits 1 on any failure.
+//
+//  g++ -std=c++11 -I.. -I. -DBQ34Z100G1_BUS=BQ34Z100G1ModelBus '-DBQ34Z100G1_BUS_HEADER="bq34z100g1_model_bus.hpp"' bq34z100g1_async_test.cpp ../bq34z100g1.cpp -o bq34z100g1_async_test
+//
+
+#include "bq34z100g1_async.hpp"
+
+#include <stdio.h>
+
+// Model bus that fails reads while nack is set.
+class FlakyBus {
+    BQ34Z100G1ModelBus bus;
+
+public:
+    bool nack;
+    
+    FlakyBus(BQ34Z100G1Model *model) : bus(model), nack(false) {}
+    
+    BQ34Z100G1Status read(uint8_t device, uint8_t address, uint8_t *data, uint8_t length) {
+        if (nack) {
+            return BQ34Z100G1_STATUS_NACK;
+        }
+        return bus.read(device, address, data, length);
+    }
+};
+
+typedef BQ34Z100G1SimulatedTransport<FlakyBus> Transport;
+typedef BQ34Z100G1AsyncReader<Transport> Reader;
+
+static unsigned long failures;
+
+static void check(bool ok, const char *what) {
+    if (!ok) {
+        failures++;
+        fprintf(stderr, "%s\n", what);
+    }
+}
+
+// Callbacks append their request's position in the test to this.
+static int order[8];
+static int finished;
+
+static void record(BQ34Z100G1AsyncRequest &request) {
+    order[finished++] = *(int *)request.context;
+}
+
+// Completes one transfer and polls, as the interrupt and main loop would.
+static void step(Transport &transport, Reader &reader) {
+    transport.complete();
+    reader.poll();
+}
+
+int main() {
+    BQ34Z100G1Model model;
+    FlakyBus bus(&model);
+    Transport transport(bus);
+    Reader reader(transport);
+    
+    // Three requests queued at once finish in order, one transfer at a time.
+    int positions[] = {0, 1, 2, 3};
+    BQ34Z100G1AsyncRequest voltage_request;
+    BQ34Z100G1AsyncRequest charge_request;
+    BQ34Z100G1AsyncRequest snapshot_request;
+    uint8_t voltage[BQ34Z100G1::Voltage::length];
+    uint8_t charge[BQ34Z100G1::StateOfCharge::length];
+    BQ34Z100G1::Snapshot snapshot;
+    check(reader.begin_read<BQ34Z100G1::Voltage>(voltage_request, voltage, record, &positions[0]), "voltage not queued");
+    check(reader.begin_read<BQ34Z100G1::StateOfCharge>(charge_request, charge, record, &positions[1]), "state of charge not queued");
+    check(reader.begin_snapshot(snapshot_request, snapshot, record, &positions[2]), "snapshot not queued");
+    check(!reader.begin_read<BQ34Z100G1::Voltage>(voltage_request, voltage), "queued request accepted again");
+    
+    reader.poll();
+    check(finished == 0 && !voltage_request.done, "request finished before its transfer");
+    for (int i = 0; i < 3; i++) {
+        step(transport, reader);
+        check(finished == i + 1, "not one request per transfer");
+    }
+    check(reader.idle(), "reader not idle");
+    check(order[0] == 0 && order[1] == 1 && order[2] == 2, "requests out of order");
+    check(voltage_request.status == BQ34Z100G1_STATUS_OK && voltage_request.get<BQ34Z100G1::Voltage>() == 14800, "wrong voltage");
+    check(charge_request.status == BQ34Z100G1_STATUS_OK && charge_request.get<BQ34Z100G1::StateOfCharge>() == 50, "wrong state of charge");
+    check(snapshot_request.status == BQ34Z100G1_STATUS_OK && snapshot.voltage == 14800 && snapshot.current == -500 && snapshot.temperature == 2982, "wrong snapshot");
+    
+    // A request waits while the driver runs a transfer for someone else.
+    finished = 0;
+    uint8_t other[2];
+    check(transport.start(BQ34Z100_G1_ADDRESS, 0x0c, other, sizeof(other)), "driver refused the other transfer");
+    check(reader.begin_read<BQ34Z100G1::Voltage>(voltage_request, voltage, record, &positions[3]), "voltage not queued behind a busy driver");
+    reader.poll();
+    check(finished == 0 && !voltage_request.done, "request ran while the driver was busy");
+    transport.complete(); // The other transfer
+    reader.poll(); // Starts ours
+    check(finished == 0 && !voltage_request.done, "request finished with the other transfer");
+    step(transport, reader);
+    check(finished == 1 && order[0] == 3 && voltage_request.get<BQ34Z100G1::Voltage>() == 14800, "request lost after the driver was busy");
+    check((other[0] | other[1] << 8) == 2982, "other transfer corrupted");
+    
+    // A NACK is reported through the callback, and the next request succeeds.
+    finished = 0;
+    bus.nack = true;
+    check(reader.begin_read<BQ34Z100G1::Voltage>(voltage_request, voltage, record, &positions[0]), "voltage not queued");
+    step(transport, reader);
+    check(finished == 1 && voltage_request.done && voltage_request.status == BQ34Z100G1_STATUS_NACK, "NACK not reported");
+    bus.nack = false;
+    check(reader.begin_read<BQ34Z100G1::Voltage>(voltage_request, voltage, record, &positions[1]), "voltage not queued after a NACK");
+    step(transport, reader);
+    check(finished == 2 && voltage_request.status == BQ34Z100G1_STATUS_OK && voltage_request.get<BQ34Z100G1::Voltage>() == 14800, "read after a NACK failed");
+    
+    printf("%lu failures\n", failures);
+    return failures ? 1 : 0;
+}
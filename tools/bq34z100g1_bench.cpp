@@ -0,0 +1,228 @@
+//
+//  bq34z100g1_bench.cpp
+//  SMC
+//
+//  Runs the public API against BQ34Z100G1Model at 100 and 400 kHz, as Linux
+//  i2c-dev and as Arduino Wire with its 32 byte buffer, and prints
+//  transactions, bytes, modeled time and NACKs per scenario as CSV. Exits 1
+//  if a scenario that changes data flash wrote no block or, given a previous
+//  output as baseline, if any scenario got more expensive.
+//
+//  g++ -std=c++11 -I.. -I. -DBQ34Z100G1_BUS=BQ34Z100G1ModelBus '-DBQ34Z100G1_BUS_HEADER="bq34z100g1_model_bus.hpp"' bq34z100g1_bench.cpp ../bq34z100g1.cpp -o bq34z100g1_bench
+//  ./bq34z100g1_bench > baseline.csv
+//  ./bq34z100g1_bench baseline.csv
+//
+
+#include "bq34z100g1.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+// Every field of a Snapshot, one getter each.
+static void telemetry_getters(BQ34Z100G1 &gauge) {
+    gauge.state_of_charge();
+    gauge.state_of_charge_max_error();
+    gauge.remaining_capacity();
+    gauge.full_charge_capacity();
+    gauge.voltage();
+    gauge.average_current();
+    gauge.temperature();
+    gauge.flags();
+    gauge.current();
+    gauge.flags_b();
+    gauge.average_time_to_empty();
+    gauge.average_time_to_full();
+    gauge.passed_charge();
+    gauge.do_d0_time();
+    gauge.available_energy();
+    gauge.average_power();
+    gauge.serial_number();
+    gauge.internal_temperature();
+    gauge.cycle_count();
+    gauge.state_of_health();
+    gauge.charge_voltage();
+    gauge.charge_current();
+    gauge.pack_configuration();
+    gauge.design_capacity();
+}
+
+static void telemetry_snapshot(BQ34Z100G1 &gauge) {
+    BQ34Z100G1::Snapshot snapshot;
+    gauge.snapshot(snapshot);
+}
+
+static void design_capacity(BQ34Z100G1 &gauge) {
+    gauge.update_design_capacity(4400);
+}
+
+static void q_max(BQ34Z100G1 &gauge) {
+    gauge.update_q_max(4400);
+}
+
+static void design_energy(BQ34Z100G1 &gauge) {
+    gauge.update_design_energy(6512);
+}
+
+static void cell_charge_voltage_range(BQ34Z100G1 &gauge) {
+    gauge.update_cell_charge_voltage_range(4200, 4200, 4200);
+}
+
+static void number_of_series_cells(BQ34Z100G1 &gauge) {
+    gauge.update_number_of_series_cells(4);
+}
+
+static void pack_configuration(BQ34Z100G1 &gauge) {
+    gauge.update_pack_configuration(0x29d9);
+}
+
+static void charge_termination_parameters(BQ34Z100G1 &gauge) {
+    gauge.update_charge_termination_parameters(100, 25, 100, 40, -1, -1, 100, -1);
+}
+
+static void profile(BQ34Z100G1 &gauge) {
+    BQ34Z100G1::PackProfile profile = {4400, 4400, 6512, 4200, 4200, 4200, 4, 0x29d9, 100, 25, 100, 40, -1, -1, 100, -1, 5};
+    gauge.apply_profile(profile);
+}
+
+static void cc_offset(BQ34Z100G1 &gauge) {
+    gauge.calibrate_cc_offset();
+}
+
+static void board_offset(BQ34Z100G1 &gauge) {
+    gauge.calibrate_board_offset();
+}
+
+static void voltage_divider(BQ34Z100G1 &gauge) {
+    gauge.calibrate_voltage_divider(14800, 4);
+}
+
+static void sense_resistor(BQ34Z100G1 &gauge) {
+    gauge.calibrate_sense_resistor(-500);
+}
+
+static void bring_up(BQ34Z100G1 &gauge) {
+    design_capacity(gauge);
+    q_max(gauge);
+    design_energy(gauge);
+    cell_charge_voltage_range(gauge);
+    number_of_series_cells(gauge);
+    pack_configuration(gauge);
+    charge_termination_parameters(gauge);
+    cc_offset(gauge);
+    board_offset(gauge);
+    voltage_divider(gauge);
+    sense_resistor(gauge);
+    gauge.set_current_deadband(5);
+    gauge.ready();
+}
+
+struct Scenario {
+    const char *name;
+    void (*run)(BQ34Z100G1 &gauge);
+    bool writes_flash;
+};
+
+static const Scenario scenarios[] = {
+    {"telemetry_getters", telemetry_getters, false},
+    {"telemetry_snapshot", telemetry_snapshot, false},
+    {"update_design_capacity", design_capacity, true},
+    {"update_q_max", q_max, true},
+    {"update_design_energy", design_energy, true},
+    {"update_cell_charge_voltage_range", cell_charge_voltage_range, true},
+    {"update_number_of_series_cells", number_of_series_cells, true},
+    {"update_pack_configuration", pack_configuration, true},
+    {"update_charge_termination_parameters", charge_termination_parameters, true},
+    {"apply_profile", profile, true},
+    {"calibrate_cc_offset", cc_offset, false},
+    {"calibrate_board_offset", board_offset, false},
+    {"calibrate_voltage_divider", voltage_divider, true},
+    {"calibrate_sense_resistor", sense_resistor, true},
+    {"bring_up", bring_up, true},
+};
+
+static const uint32_t clocks[] = {100000, 400000};
+
+struct Bus {
+    const char *name;
+    uint8_t buffer_length;
+};
+
+static const Bus buses[] = {
+    {"linux", 0},
+    {"wire", 32},
+};
+
+struct Result {
+    char name[48];
+    char bus[8];
+    unsigned khz;
+    unsigned long transactions;
+    unsigned long bytes;
+    double ms;
+};
+
+// Returns true if current is no worse than the matching baseline line.
+static bool compare(FILE *baseline, const Result &current) {
+    rewind(baseline);
+    Result previous;
+    unsigned long nacks;
+    char line[128];
+    while (fgets(line, sizeof(line), baseline)) {
+        if (sscanf(line, "%47[^,],%7[^,],%u,%lu,%lu,%lf,%lu", previous.name, previous.bus, &previous.khz, &previous.transactions, &previous.bytes, &previous.ms, &nacks) != 7) {
+            continue;
+        }
+        if (strcmp(previous.name, current.name) != 0 || strcmp(previous.bus, current.bus) != 0 || previous.khz != current.khz) {
+            continue;
+        }
+        if (current.transactions > previous.transactions || current.bytes > previous.bytes || current.ms > previous.ms * 1.01 + 0.05) { // Baseline is printed to 0.1 ms
+            fprintf(stderr, "%s on %s at %u kHz: %lu transactions, %lu bytes, %.1f ms (was %lu, %lu, %.1f)\n", current.name, current.bus, current.khz, current.transactions, current.bytes, current.ms, previous.transactions, previous.bytes, previous.ms);
+            return false;
+        }
+        return true;
+    }
+    return true; // New scenario
+}
+
+int main(int argc, char **argv) {
+    FILE *baseline = 0;
+    if (argc > 1 && !(baseline = fopen(argv[1], "r"))) {
+        perror(argv[1]);
+        return 2;
+    }
+    
+    bool ok = true;
+    printf("scenario,bus,khz,transactions,bytes,ms,nacks\n");
+    for (uint8_t b = 0; b < sizeof(buses) / sizeof(buses[0]); b++) {
+        for (uint8_t c = 0; c < sizeof(clocks) / sizeof(clocks[0]); c++) {
+            for (uint8_t s = 0; s < sizeof(scenarios) / sizeof(scenarios[0]); s++) {
+                BQ34Z100G1Model model;
+                model.clock = clocks[c];
+                model.buffer_length = buses[b].buffer_length;
+                BQ34Z100G1ModelBus bus(&model);
+                BQ34Z100G1 gauge(bus);
+                scenarios[s].run(gauge);
+                
+                Result result;
+                snprintf(result.name, sizeof(result.name), "%s", scenarios[s].name);
+                snprintf(result.bus, sizeof(result.bus), "%s", buses[b].name);
+                result.khz = clocks[c] / 1000;
+                result.transactions = model.transactions;
+                result.bytes = model.bytes;
+                result.ms = model.now / 1000.0;
+                printf("%s,%s,%u,%lu,%lu,%.1f,%lu\n", result.name, result.bus, result.khz, result.transactions, result.bytes, result.ms, (unsigned long)model.nacks);
+                if (scenarios[s].writes_flash && model.flash_writes == 0) {
+                    fprintf(stderr, "%s on %s at %u kHz: no data flash block written\n", result.name, result.bus, result.khz);
+                    ok = false;
+                }
+                if (baseline) {
+                    ok &= compare(baseline, result);
+                }
+            }
+        }
+    }
+    
+    if (baseline) {
+        fclose(baseline);
+    }
+    return ok ? 0 : 1;
+}
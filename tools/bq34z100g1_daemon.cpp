@@ -0,0 +1,106 @@
+//
+//  bq34z100g1_daemon.cpp
+//  SMC
+//
+//  Owns the I2C adapters of one or more gauges and publishes a snapshot of
+//  each into shared memory every period, for BQ34Z100G1SharedReader clients.
+//  Gauges are polled in parallel, one per adapter, in the order given.
+//
+//  bq34z100g1_daemon [-p period_ms] [-n name] <adapter>...
+//
+//  g++ -std=c++11 -pthread -I.. bq34z100g1_daemon.cpp ../bq34z100g1.cpp ../bq34z100g1_linux.cpp ../bq34z100g1_executor.cpp ../bq34z100g1_shared.cpp -lrt -o bq34z100g1_daemon
+//
+
+#include "bq34z100g1_executor.hpp"
+#include "bq34z100g1_shared.hpp"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+static volatile sig_atomic_t running = 1;
+
+static void stop(int) {
+    running = 0;
+}
+
+static uint64_t monotonic_ms() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static int usage() {
+    fprintf(stderr, "usage: bq34z100g1_daemon [-p period_ms] [-n name] <adapter>...\n");
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    unsigned long period = 1000;
+    const char *name = BQ34Z100G1_SHARED_NAME;
+    int option;
+    while ((option = getopt(argc, argv, "p:n:")) != -1) {
+        switch (option) {
+            case 'p': period = strtoul(optarg, 0, 10); break;
+            case 'n': name = optarg; break;
+            default: return usage();
+        }
+    }
+    int count = argc - optind;
+    if (count < 1 || count > BQ34Z100G1_SHARED_GAUGES || period == 0) {
+        return usage();
+    }
+    
+    std::vector<BQ34Z100G1LinuxBus> buses(count);
+    std::vector<std::unique_ptr<BQ34Z100G1> > gauges;
+    BQ34Z100G1Executor executor;
+    for (int i = 0; i < count; i++) {
+        int adapter = atoi(argv[optind + i]);
+        if (!buses[i].open(adapter)) {
+            fprintf(stderr, "bq34z100g1_daemon: cannot open /dev/i2c-%d\n", adapter);
+            return 1;
+        }
+        gauges.push_back(std::unique_ptr<BQ34Z100G1>(new BQ34Z100G1(buses[i])));
+        executor.add(*gauges[i], adapter);
+    }
+    
+    BQ34Z100G1SharedWriter writer;
+    if (!writer.create(count, name)) {
+        perror(name);
+        return 1;
+    }
+    
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+    uint64_t next = monotonic_ms();
+    while (running) {
+        std::vector<std::future<BQ34Z100G1Executor::Sample> > samples;
+        for (int i = 0; i < count; i++) {
+            samples.push_back(executor.sample(i));
+        }
+        for (int i = 0; i < count; i++) {
+            BQ34Z100G1Executor::Sample sample = samples[i].get();
+            BQ34Z100G1SharedSample shared;
+            shared.time = monotonic_ms();
+            shared.snapshot = sample.snapshot;
+            shared.status = sample.status;
+            shared.consistent = sample.consistent;
+            writer.publish(i, shared);
+        }
+        next += period;
+        uint64_t now = monotonic_ms();
+        if (next > now) {
+            usleep((next - now) * 1000);
+        } else {
+            next = now; // Overran, do not try to catch up
+        }
+    }
+    
+    writer.close();
+    for (int i = 0; i < count; i++) {
+        buses[i].close();
+    }
+    return 0;
+}
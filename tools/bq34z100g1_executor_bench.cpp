@@ -0,0 +1,58 @@
+//
+//  bq34z100g1_executor_bench.cpp
+//  SMC
+//
+//  Samples gauges through BQ34Z100G1Executor on one to four modeled adapters
+//  and prints samples per second as CSV. The models sleep through their bus
+//  time, so the rate should grow with the number of adapters.
+//
+//  g++ -std=c++11 -pthread -I.. -I. -DBQ34Z100G1_BUS=BQ34Z100G1ModelBus '-DBQ34Z100G1_BUS_HEADER="bq34z100g1_model_bus.hpp"' bq34z100g1_executor_bench.cpp ../bq34z100g1.cpp ../bq34z100g1_executor.cpp -o bq34z100g1_executor_bench
+//  ./bq34z100g1_executor_bench
+//
+
+#include "bq34z100g1_executor.hpp"
+
+#include <chrono>
+#include <stdio.h>
+
+static const int gauges_per_adapter = 2;
+static const int rounds = 20;
+
+int main() {
+    bool ok = true;
+    printf("adapters,gauges,samples,seconds,samples_per_second\n");
+    for (int adapters = 1; adapters <= 4; adapters++) {
+        int count = adapters * gauges_per_adapter;
+        std::vector<BQ34Z100G1Model> models(count);
+        std::vector<BQ34Z100G1ModelBus> buses;
+        std::vector<std::unique_ptr<BQ34Z100G1> > gauges;
+        BQ34Z100G1Executor executor;
+        for (int i = 0; i < count; i++) {
+            models[i].clock = 400000;
+            models[i].realtime = true;
+            buses.push_back(BQ34Z100G1ModelBus(&models[i]));
+        }
+        for (int i = 0; i < count; i++) {
+            gauges.push_back(std::unique_ptr<BQ34Z100G1>(new BQ34Z100G1(buses[i])));
+            executor.add(*gauges[i], i % adapters);
+        }
+        
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::vector<std::future<BQ34Z100G1Executor::Sample> > samples;
+        for (int r = 0; r < rounds; r++) {
+            for (int i = 0; i < count; i++) {
+                samples.push_back(executor.sample(i));
+            }
+        }
+        for (size_t i = 0; i < samples.size(); i++) {
+            BQ34Z100G1Executor::Sample sample = samples[i].get();
+            if (sample.status != BQ34Z100G1_STATUS_OK || sample.snapshot.voltage != 14800) {
+                fprintf(stderr, "sample %zu: status %d, %u mV\n", i, (int)sample.status, (unsigned)sample.snapshot.voltage);
+                ok = false;
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("%d,%d,%zu,%.3f,%.0f\n", adapters, count, samples.size(), seconds, samples.size() / seconds);
+    }
+    return ok ? 0 : 1;
+}
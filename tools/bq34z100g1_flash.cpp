@@ -0,0 +1,130 @@
+//
+//  bq34z100g1_flash.cpp
+//  SMC
+//
+//  Dumps, compares and restores BQ34Z100G1FlashImage files on Linux, and runs
+//  TI flash stream files. restore leaves the gauge's learned data alone
+//  unless given --learned.
+//
+//  bq34z100g1_flash dump <adapter> <image>
+//  bq34z100g1_flash diff <image> <image>
+//  bq34z100g1_flash restore <adapter> <image> [--learned]
+//  bq34z100g1_flash program <adapter> <file.df.fs>
+//
+//  g++ -std=c++11 -I.. bq34z100g1_flash.cpp ../bq34z100g1.cpp ../bq34z100g1_linux.cpp ../bq34z100g1_flash.cpp ../bq34z100g1_stream.cpp -o bq34z100g1_flash
+//
+
+#include "bq34z100g1_flash.hpp"
+#include "bq34z100g1_stream.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static bool load(const char *path, std::vector<uint8_t> &image) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+    int byte;
+    while ((byte = fgetc(file)) != EOF) {
+        image.push_back(byte);
+    }
+    fclose(file);
+    if (image.size() > 0xffff || !BQ34Z100G1FlashImage::valid(image.data(), image.size())) {
+        fprintf(stderr, "bq34z100g1_flash: %s is not a data flash image\n", path);
+        return false;
+    }
+    return true;
+}
+
+static int dump(BQ34Z100G1 &gauge, const char *path) {
+    std::vector<uint8_t> image(BQ34Z100G1FlashImage::size());
+    uint16_t length = BQ34Z100G1FlashImage::dump(gauge, image.data(), image.size());
+    if (length == 0) {
+        fprintf(stderr, "bq34z100g1_flash: dump failed, %s not written\n", path);
+        return 1;
+    }
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        perror(path);
+        return 1;
+    }
+    bool ok = fwrite(image.data(), 1, length, file) == length;
+    ok &= fclose(file) == 0;
+    return ok ? 0 : 1;
+}
+
+static int diff(const char *path_a, const char *path_b) {
+    std::vector<uint8_t> a, b;
+    if (!load(path_a, a) || !load(path_b, b)) {
+        return 2;
+    }
+    BQ34Z100G1FlashImage::Difference differences[255];
+    uint8_t count = BQ34Z100G1FlashImage::diff(a.data(), b.data(), differences, 255);
+    for (uint8_t n = 0; n < count; n++) {
+        printf("subclass %u offset %u length %u\n", differences[n].sub_class, differences[n].offset, differences[n].length);
+    }
+    return count ? 1 : 0;
+}
+
+static int restore(BQ34Z100G1 &gauge, const char *path, bool learned) {
+    std::vector<uint8_t> image;
+    if (!load(path, image)) {
+        return 2;
+    }
+    if (!BQ34Z100G1FlashImage::restore(gauge, image.data(), image.size(), learned)) {
+        fprintf(stderr, "bq34z100g1_flash: restore failed or did not verify\n");
+        return 1;
+    }
+    return 0;
+}
+
+static int program(BQ34Z100G1 &gauge, const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        perror(path);
+        return 2;
+    }
+    BQ34Z100G1FlashStream stream(gauge);
+    int c;
+    while ((c = fgetc(file)) != EOF && stream.feed(c)) {
+    }
+    fclose(file);
+    if (!stream.finish()) {
+        static const char *const results[] = {"ok", "syntax error", "line too long", "transfer failed", "compare failed"};
+        fprintf(stderr, "bq34z100g1_flash: %s:%lu: %s\n", path, (unsigned long)stream.line(), results[stream.result()]);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    bool learned = argc == 5 && strcmp(argv[1], "restore") == 0 && strcmp(argv[4], "--learned") == 0;
+    if (argc != 4 && !learned) {
+        fprintf(stderr, "usage: bq34z100g1_flash dump <adapter> <image>\n       bq34z100g1_flash restore <adapter> <image> [--learned]\n       bq34z100g1_flash diff <image> <image>\n       bq34z100g1_flash program <adapter> <file.df.fs>\n");
+        return 2;
+    }
+    if (strcmp(argv[1], "diff") == 0) {
+        return diff(argv[2], argv[3]);
+    }
+    
+    BQ34Z100G1LinuxBus bus;
+    if (!bus.open(atoi(argv[2]))) {
+        fprintf(stderr, "bq34z100g1_flash: cannot open /dev/i2c-%s\n", argv[2]);
+        return 2;
+    }
+    BQ34Z100G1 gauge(bus);
+    int status = 2;
+    if (strcmp(argv[1], "dump") == 0) {
+        status = dump(gauge, argv[3]);
+    } else if (strcmp(argv[1], "restore") == 0) {
+        status = restore(gauge, argv[3], learned);
+    } else if (strcmp(argv[1], "program") == 0) {
+        status = program(gauge, argv[3]);
+    }
+    bus.close();
+    return status;
+}
@@ -0,0 +1,33 @@
+//
+//  bq34z100g1_log_csv.cpp
+//  SMC
+//
+//  Converts a BQ34Z100G1Log::export_image() dump read from stdin to CSV.
+//
+//  g++ -std=c++11 -I.. bq34z100g1_log_csv.cpp ../bq34z100g1_log.cpp -o bq34z100g1_log_csv
+//
+
+#include "bq34z100g1_log.hpp"
+
+#include <stdio.h>
+#include <vector>
+
+int main() {
+    std::vector<uint8_t> image;
+    int byte;
+    while ((byte = getchar()) != EOF) {
+        image.push_back(byte);
+    }
+    if (image.empty() || image.size() > 0xffff) {
+        fprintf(stderr, "bq34z100g1_log_csv: expected an export image on stdin\n");
+        return 1;
+    }
+    
+    BQ34Z100G1Log::Cursor cursor(image.data(), image.size());
+    BQ34Z100G1Log::Sample sample;
+    printf("time_ms,voltage_mv,current_ma,temperature_dk,state_of_charge,flags\n");
+    while (cursor.next(sample)) {
+        printf("%lu,%u,%d,%u,%u,0x%04x\n", (unsigned long)sample.time, sample.voltage, sample.current, sample.temperature, sample.state_of_charge, sample.flags);
+    }
+    return 0;
+}
@@ -0,0 +1,288 @@
+//
+//  bq34z100g1_model_bus.hpp
+//  SMC
+//
+
+#ifndef bq34z100g1_model_bus_hpp
+#define bq34z100g1_model_bus_hpp
+
+#include <stdint.h>
+#include <string.h>
+#include <map>
+#include <chrono>
+#include <thread>
+
+#include "bq34z100g1_status.hpp"
+
+/*
+ Host model of a gauge on an I2C bus, for measuring what the library costs
+ without hardware. Select it with
+
+ -DBQ34Z100G1_BUS=BQ34Z100G1ModelBus '-DBQ34Z100G1_BUS_HEADER="bq34z100g1_model_bus.hpp"'
+
+ Time only advances through the model: each transfer costs its bits at the
+ bus clock (start, address, register, data, acknowledges, stop) plus the
+ clock stretching of the gauge, and delay() adds the requested time. The
+ gauge answers standard commands from a register file, implements the
+ control subcommands the library uses and keeps data flash behind the block
+ interface. A block write, a reset and a calibration each take their modeled
+ time, during which the gauge does not acknowledge, as on the real part.
+ With buffer_length set, transfers are split as BQ34Z100G1WireBus splits
+ them (32 bytes per read, 31 data bytes per write on AVR Wire), so the
+ counts match an Arduino rather than Linux i2c-dev.
+
+ With realtime set, the calling thread also sleeps for the modeled time, so
+ gauges on separate threads overlap as they would on separate adapters.
+ */
+
+class BQ34Z100G1Model {
+public:
+    uint32_t clock; // Hz
+    uint32_t stretch; // us the gauge holds SCL low per transfer
+    uint32_t flash_write_time; // us
+    uint32_t reset_time; // us
+    uint32_t calibration_time; // us for CC or board offset
+    bool realtime; // Sleep through modeled time
+    uint8_t buffer_length; // Bytes per transfer, 0 for no limit
+    
+    uint64_t now; // us
+    uint32_t transactions;
+    uint32_t bytes;
+    uint32_t nacks;
+    uint32_t flash_writes; // Blocks written to data flash
+    
+    uint8_t registers[0x80]; // Standard and extended commands
+    
+    BQ34Z100G1Model() : clock(100000), stretch(100), flash_write_time(30000), reset_time(250000), calibration_time(4000000), realtime(false), buffer_length(0), now(0), transactions(0), bytes(0), nacks(0), flash_writes(0), sub_command(0), resets(0), cal_enabled(false), cal_mode(false), calibration(false), calibration_end(0), busy_until(0), sub_class(0), block(0) {
+        memset(registers, 0, sizeof(registers));
+        set_register(0x02, 50, 1); // State of charge
+        set_register(0x08, 14800, 2); // Voltage
+        set_register(0x0c, 2982, 2); // Temperature
+        set_register(0x10, (uint16_t)-500, 2); // Current
+        memset(buffer, 0, sizeof(buffer));
+        
+        uint8_t *calibration_data = flash(104, 0);
+        static const uint8_t cc_gain[4] = {0x7f, 0x74, 0x1f, 0x21}; // 0.4768
+        static const uint8_t cc_delta[4] = {0x94, 0x0a, 0x9c, 0x0a}; // 567744.6
+        memcpy(calibration_data, cc_gain, 4);
+        memcpy(calibration_data + 4, cc_delta, 4);
+        calibration_data[14] = 16000 >> 8; // Voltage divider for a 4 cell pack
+        calibration_data[15] = 16000 & 0xff;
+    }
+    
+    void set_register(uint8_t address, uint16_t value, uint8_t length) {
+        registers[address] = value & 0xff;
+        if (length == 2) {
+            registers[address + 1] = value >> 8;
+        }
+    }
+    
+    void advance(uint64_t us) {
+        now += us;
+        if (realtime) {
+            std::this_thread::sleep_for(std::chrono::microseconds(us));
+        }
+    }
+    
+    uint8_t *flash(uint8_t sub_class, uint8_t block) {
+        Block &entry = flash_blocks[sub_class << 8 | block];
+        return entry.data;
+    }
+    
+    BQ34Z100G1Status read(uint8_t address, uint8_t *data, uint8_t length) {
+        do {
+            uint8_t chunk = buffer_length && length > buffer_length ? buffer_length : length;
+            transfer(3 + chunk);
+            if (!acknowledge()) {
+                return BQ34Z100G1_STATUS_NACK;
+            }
+            for (uint8_t i = 0; i < chunk; i++) {
+                data[i] = read_byte(address + i);
+            }
+            address += chunk;
+            data += chunk;
+            length -= chunk;
+        } while (length > 0);
+        return BQ34Z100G1_STATUS_OK;
+    }
+    
+    BQ34Z100G1Status write(uint8_t address, const uint8_t *data, uint8_t length) {
+        do {
+            uint8_t chunk = buffer_length && length > buffer_length - 1 ? buffer_length - 1 : length; // One byte goes to the register address
+            transfer(2 + chunk);
+            if (!acknowledge()) {
+                return BQ34Z100G1_STATUS_NACK;
+            }
+            if (address == 0x00 && length == 2) {
+                control(data[0] | data[1] << 8);
+                return BQ34Z100G1_STATUS_OK;
+            }
+            for (uint8_t i = 0; i < chunk; i++) {
+                write_byte(address + i, data[i]);
+            }
+            address += chunk;
+            data += chunk;
+            length -= chunk;
+        } while (length > 0);
+        return BQ34Z100G1_STATUS_OK;
+    }
+
+private:
+    struct Block {
+        uint8_t data[32];
+        Block() { memset(data, 0, sizeof(data)); }
+    };
+    std::map<uint16_t, Block> flash_blocks;
+    
+    uint16_t sub_command;
+    uint16_t resets;
+    bool cal_enabled; // CAL_ENABLE toggled on
+    bool cal_mode; // CALEN
+    bool calibration;
+    uint64_t calibration_end;
+    uint64_t busy_until;
+    uint8_t sub_class;
+    uint8_t block;
+    uint8_t buffer[32];
+    
+    // Address, register and data bytes at 9 clocks each, plus start and stop.
+    void transfer(uint8_t frame_bytes) {
+        transactions++;
+        bytes += frame_bytes;
+        advance((uint64_t)(frame_bytes * 9 + 2) * 1000000 / clock + stretch);
+    }
+    
+    bool acknowledge() {
+        if (now < busy_until) {
+            nacks++;
+            return false;
+        }
+        return true;
+    }
+    
+    uint8_t checksum() const {
+        uint8_t sum = 0;
+        for (uint8_t i = 0; i < 32; i++) {
+            sum += buffer[i];
+        }
+        return 255 - sum;
+    }
+    
+    uint16_t control_status() const {
+        uint16_t status = cal_mode ? 0x1000 : 0; // CALEN
+        if (calibration && now < calibration_end) {
+            status |= 0x0c00; // CCA, BCA
+        }
+        return status;
+    }
+    
+    uint16_t control_response() const {
+        switch (sub_command) {
+            case 0x0000: return control_status();
+            case 0x0001: return 0x0100; // Device type
+            case 0x0002: return 0x0117; // FW version
+            case 0x0003: return 0x00a8; // HW version
+            case 0x0005: return resets;
+            case 0x0008: return 0x0100; // Chem ID
+            case 0x000c: return 0x0001; // DF version
+            default: return 0;
+        }
+    }
+    
+    void control(uint16_t command) {
+        sub_command = command;
+        switch (command) {
+            case 0x0041: // RESET
+                resets++;
+                cal_enabled = false;
+                cal_mode = false;
+                busy_until = now + reset_time;
+                break;
+            case 0x002d: // CAL_ENABLE
+                cal_enabled = !cal_enabled;
+                break;
+            case 0x0081: // ENTER_CAL
+                cal_mode = cal_enabled;
+                break;
+            case 0x0009: // BOARD_OFFSET
+            case 0x000a: // CC_OFFSET
+                if (cal_mode) {
+                    calibration = true;
+                    calibration_end = now + calibration_time;
+                }
+                break;
+            case 0x0080: // EXIT_CAL
+                cal_mode = false;
+                calibration = false;
+                break;
+            default:
+                break;
+        }
+    }
+    
+    uint8_t read_byte(uint8_t address) {
+        if (address <= 0x01) {
+            uint16_t response = control_response();
+            return address == 0x00 ? response & 0xff : response >> 8;
+        }
+        if (address >= 0x40 && address < 0x60) {
+            return buffer[address - 0x40];
+        }
+        if (address == 0x60) {
+            return checksum();
+        }
+        return address < sizeof(registers) ? registers[address] : 0;
+    }
+    
+    void write_byte(uint8_t address, uint8_t value) {
+        if (address == 0x3e) {
+            sub_class = value;
+        } else if (address == 0x3f) {
+            block = value;
+            memcpy(buffer, flash(sub_class, block), 32);
+        } else if (address >= 0x40 && address < 0x60) {
+            buffer[address - 0x40] = value;
+        } else if (address == 0x60 && value == checksum()) {
+            memcpy(flash(sub_class, block), buffer, 32);
+            flash_writes++;
+            busy_until = now + flash_write_time;
+        } else if (address < sizeof(registers)) {
+            registers[address] = value;
+        }
+    }
+};
+
+class BQ34Z100G1ModelBus {
+    BQ34Z100G1Model *model;
+
+public:
+    BQ34Z100G1ModelBus(BQ34Z100G1Model *model = 0) : model(model) {}
+    
+    BQ34Z100G1Status read(uint8_t device, uint8_t address, uint8_t *data, uint8_t length) {
+        (void)device;
+        return model->read(address, data, length);
+    }
+    
+    BQ34Z100G1Status write(uint8_t device, uint8_t address, const uint8_t *data, uint8_t length) {
+        (void)device;
+        return model->write(address, data, length);
+    }
+    
+    void recover() {
+        model->advance(100); // Nine clocks and a STOP
+    }
+    
+    void delay(uint32_t ms) {
+        model->advance((uint64_t)ms * 1000);
+    }
+    
+    uint32_t millis() {
+        return model->now / 1000;
+    }
+    
+    uint32_t micros() {
+        return model->now;
+    }
+};
+
+#endif /* bq34z100g1_model_bus_hpp */
@@ -0,0 +1,87 @@
+//
+//  bq34z100g1_publisher_stress.cpp
+//  SMC
+//
+//  Publishes samples from one thread as fast as it can while reader threads
+//  check every sample they get is whole and no older than the one before.
+//  Exits 1 on a torn or out of order read.
+//
+//  g++ -std=c++11 -O2 -pthread -I.. bq34z100g1_publisher_stress.cpp -o bq34z100g1_publisher_stress
+//  g++ -std=c++11 -O1 -g -fsanitize=thread -pthread -I.. bq34z100g1_publisher_stress.cpp -o bq34z100g1_publisher_stress
+//  ./bq34z100g1_publisher_stress [readers] [publishes]
+//
+
+#include "bq34z100g1_publisher.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+// Every field derives from the publish number, so a mix of two is visible.
+static BQ34Z100G1Publisher::Sample make_sample(uint32_t n) {
+    BQ34Z100G1Publisher::Sample sample;
+    memset(&sample, 0, sizeof(sample));
+    sample.time = n;
+    sample.snapshot.voltage = n;
+    sample.snapshot.current = ~n;
+    sample.snapshot.flags = n * 3;
+    sample.snapshot.state_of_charge = n * 7;
+    sample.snapshot.flags_b = n >> 16;
+    return sample;
+}
+
+static bool whole(const BQ34Z100G1Publisher::Sample &sample) {
+    BQ34Z100G1Publisher::Sample expected = make_sample(sample.time);
+    return memcmp(&sample, &expected, sizeof(sample)) == 0;
+}
+
+struct Reader {
+    unsigned long reads;
+    unsigned long busy; // Gave up after read_attempts
+    unsigned long torn;
+    unsigned long backwards;
+};
+
+int main(int argc, char **argv) {
+    int readers = argc > 1 ? atoi(argv[1]) : 4;
+    uint32_t publishes = argc > 2 ? strtoul(argv[2], 0, 10) : 2000000;
+    
+    BQ34Z100G1Published<BQ34Z100G1Publisher::Sample> published;
+    std::atomic<bool> stop(false);
+    std::vector<Reader> results(readers);
+    std::vector<std::thread> threads;
+    for (int r = 0; r < readers; r++) {
+        threads.push_back(std::thread([&published, &stop, &results, r]() {
+            Reader &result = results[r];
+            result.reads = result.busy = result.torn = result.backwards = 0;
+            uint32_t last = 0;
+            BQ34Z100G1Publisher::Sample sample;
+            while (!stop.load(std::memory_order_relaxed)) {
+                if (!published.read(sample)) {
+                    result.busy += published.count() != 0;
+                    continue;
+                }
+                result.reads++;
+                result.torn += !whole(sample);
+                result.backwards += sample.time < last;
+                last = sample.time;
+            }
+        }));
+    }
+    
+    for (uint32_t n = 1; n <= publishes; n++) {
+        published.publish(make_sample(n));
+    }
+    stop = true;
+    
+    bool ok = true;
+    for (int r = 0; r < readers; r++) {
+        threads[r].join();
+        printf("reader %d: %lu reads, %lu overtaken, %lu torn, %lu out of order\n", r, results[r].reads, results[r].busy, results[r].torn, results[r].backwards);
+        ok &= results[r].torn == 0 && results[r].backwards == 0;
+    }
+    BQ34Z100G1Publisher::Sample sample;
+    ok &= published.read(sample) && sample.time == publishes && published.count() == publishes;
+    return ok ? 0 : 1;
+}
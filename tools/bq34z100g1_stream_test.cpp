@@ -0,0 +1,113 @@
+//
+//  bq34z100g1_stream_test.cpp
+//  SMC
+//
+//  Runs small flash stream files through BQ34Z100G1FlashStream on
+//  BQ34Z100G1Model and checks the transactions sent, the data flash that
+//  results, that an X after a checksum write returns once the write is
+//  done, and the result and line number of bad files. Exits 1 on any
+//  failure.
+//
+//  g++ -std=c++11 -I.. -I. -DBQ34Z100G1_BUS=BQ34Z100G1ModelBus '-DBQ34Z100G1_BUS_HEADER="bq34z100g1_model_bus.hpp"' bq34z100g1_stream_test.cpp ../bq34z100g1.cpp ../bq34z100g1_stream.cpp -o bq34z100g1_stream_test
+//
+
+#include "bq34z100g1_stream.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+// Design capacity 4400 mAh into Data (48), block 0. The block data lines
+// merge into one write; the checksum goes on its own and the X polls for it.
+static const char design_capacity[] =
+    ";\n"
+    "; Design capacity\n"
+    ";\n"
+    "W: AA 61 00\n"
+    "W: AA 3E 30\n"
+    "W: AA 3F 00\n"
+    "W: AA 40 00 00 00 00 00 00 00 00\n"
+    "W: AA 48 00 00 00 11 30 00 00 00\n"
+    "W: AA 50 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00\n"
+    "W: AA 60 BE\n"
+    "X: 200\n"
+    "C: AA 4B 11 30 ; read back\n"
+    "\n";
+
+// The same block with the checksum on the last data line: the lines before
+// it go out together, that line on its own. No newline at the end.
+static const char boundary[] =
+    "W: AA 61 00\r\n"
+    "W: AA 3E 30\r\n"
+    "W: AA 3F 00\r\n"
+    "W: AA 40 00 00 00 00 00 00 00 00\r\n"
+    "W: AA 48 00 00 00 11 30 00 00 00\r\n"
+    "W: AA 50 00 00 00 00 00 00 00 00\r\n"
+    "w: aa 58 00 00 00 00 00 00 00 00 be\r\n"
+    "X: 200";
+
+struct Case {
+    const char *name;
+    const char *text;
+    BQ34Z100G1FlashStream::Result result;
+    uint32_t line;
+};
+
+static const Case bad[] = {
+    {"compare mismatch", "W: AA 61 00\nW: AA 3E 30\nW: AA 3F 00\nC: AA 4B 11 30\n", BQ34Z100G1FlashStream::MISMATCH, 4},
+    {"bad digit", "; ok\nW: AA 4G 00\n", BQ34Z100G1FlashStream::SYNTAX, 2},
+    {"odd device address", "\n\nW: AB 00 00\n", BQ34Z100G1FlashStream::SYNTAX, 3},
+    {"unknown command", "Q: AA 00 00\n", BQ34Z100G1FlashStream::SYNTAX, 1},
+    {"missing colon", "X 20\n", BQ34Z100G1FlashStream::SYNTAX, 1},
+    {"short write", "W: AA 40\n", BQ34Z100G1FlashStream::SYNTAX, 1},
+    {"read without count", "X: 1\nR: AA 40\n", BQ34Z100G1FlashStream::SYNTAX, 2},
+};
+
+static unsigned long failures;
+
+static void check(bool ok, const char *name, const char *what) {
+    if (!ok) {
+        failures++;
+        fprintf(stderr, "%s: %s\n", name, what);
+    }
+}
+
+// Runs a good file and checks Design Capacity landed in one flash write.
+static void run_good(const char *name, const char *text, uint32_t expected_transactions) {
+    BQ34Z100G1Model model;
+    BQ34Z100G1ModelBus bus(&model);
+    BQ34Z100G1 gauge(bus);
+    BQ34Z100G1FlashStream stream(gauge);
+    
+    bool fed = stream.feed(text, strlen(text));
+    bool finished = stream.finish();
+    check(fed && finished && stream.result() == BQ34Z100G1FlashStream::OK, name, "file failed");
+    check(stream.transactions() == expected_transactions, name, "wrong number of transactions");
+    check(model.flash_writes == 1, name, "flash not written once");
+    const uint8_t *data = model.flash(48, 0);
+    check(data[11] == 0x11 && data[12] == 0x30, name, "wrong flash contents");
+    check(model.now < 200000, name, "X waited its full time after the checksum");
+    check(gauge.get<BQ34Z100G1::DataFlash::DesignCapacity>() == 4400, name, "gauge reads stale design capacity");
+}
+
+int main() {
+    // 61, 3E, 3F, the merged block data, the checksum and the compare.
+    run_good("design capacity", design_capacity, 6);
+    // 61, 3E, 3F, the first three data lines, the last one with the checksum.
+    run_good("block boundary", boundary, 5);
+    
+    for (size_t n = 0; n < sizeof(bad) / sizeof(bad[0]); n++) {
+        BQ34Z100G1Model model;
+        BQ34Z100G1ModelBus bus(&model);
+        BQ34Z100G1 gauge(bus);
+        BQ34Z100G1FlashStream stream(gauge);
+        
+        stream.feed(bad[n].text, strlen(bad[n].text));
+        check(!stream.finish(), bad[n].name, "bad file accepted");
+        check(stream.result() == bad[n].result, bad[n].name, "wrong result");
+        check(stream.line() == bad[n].line, bad[n].name, "wrong line");
+        check(!stream.feed('\n'), bad[n].name, "input accepted after the failure");
+    }
+    
+    printf("%lu failures\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,123 @@
+//
+//  bq34z100g1_xemics_test.cpp
+//  SMC
+//
+//  Checks ieee754_to_xemics() and xemics_to_ieee754() against the pow()
+//  decoder they replaced and round trips both ways: every mantissa for a few
+//  exponents, and edge mantissas plus one in every 4099 for every exponent
+//  and sign the gauge can hold. Then times both decoders. Exits 1 on any
+//  mismatch.
+//
+//  g++ -std=c++11 -O2 -I.. bq34z100g1_xemics_test.cpp -o bq34z100g1_xemics_test
+//
+
+#include "bq34z100g1.hpp"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+
+// The decoder before integer conversion, as it was in bq34z100g1.cpp.
+static double reference_decode(uint32_t value) {
+    int16_t exp_gain = (value >> 24) - 128 - 24;
+    double exponent = pow(2, exp_gain);
+    double mantissa = (int32_t)((value & 0xffffff) | 0x800000);
+    return value & 0x800000 ? -mantissa * exponent : mantissa * exponent;
+}
+
+static float to_float(uint32_t bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static const uint32_t mantissas[] = {0, 1, 2, 0x3fffff, 0x400000, 0x555555, 0x7ffffe, 0x7fffff};
+static const uint32_t stride = 4099; // Prime, about 2000 mantissas per exponent
+
+// Exponents whose every mantissa is checked: smallest, around 1.0, largest.
+static const uint32_t xemics_exponents[] = {3, 128, 129, 255};
+static const uint32_t ieee754_exponents[] = {1, 126, 127, 253};
+
+static unsigned long failures;
+static unsigned long checked;
+
+static void check(bool ok, const char *what, uint32_t value) {
+    if (!ok && failures++ < 20) {
+        fprintf(stderr, "%s: 0x%08lx\n", what, (unsigned long)value);
+    }
+}
+
+static void check_xemics(uint32_t value) {
+    check(to_float(xemics_to_ieee754(value)) == (float)reference_decode(value), "decode", value);
+    check(ieee754_to_xemics(xemics_to_ieee754(value)) == value, "round trip", value);
+    checked++;
+}
+
+static void check_ieee754(uint32_t bits) {
+    check(xemics_to_ieee754(ieee754_to_xemics(bits)) == bits, "ieee754 round trip", bits);
+    checked++;
+}
+
+// Edge mantissas and a stride through the rest, or all of them.
+static void sweep(void (*check_value)(uint32_t), uint32_t base, bool every) {
+    for (size_t m = 0; m < sizeof(mantissas) / sizeof(mantissas[0]); m++) {
+        check_value(base | mantissas[m]);
+    }
+    for (uint32_t mantissa = 0; mantissa <= 0x7fffff; mantissa += every ? 1 : stride) {
+        check_value(base | mantissa);
+    }
+}
+
+static bool contains(const uint32_t *list, size_t count, uint32_t value) {
+    for (size_t n = 0; n < count; n++) {
+        if (list[n] == value) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int main() {
+    // Every Xemics exponent the gauge can hold decodes like the old code.
+    for (uint32_t exponent = 3; exponent <= 255; exponent++) {
+        bool every = contains(xemics_exponents, sizeof(xemics_exponents) / sizeof(xemics_exponents[0]), exponent);
+        for (uint32_t sign = 0; sign <= 1; sign++) {
+            sweep(check_xemics, exponent << 24 | sign << 23, every);
+        }
+    }
+    
+    // Every normal IEEE 754 exponent below saturation survives the round trip.
+    for (uint32_t exponent = 1; exponent <= 253; exponent++) {
+        bool every = contains(ieee754_exponents, sizeof(ieee754_exponents) / sizeof(ieee754_exponents[0]), exponent);
+        for (uint32_t sign = 0; sign <= 1; sign++) {
+            sweep(check_ieee754, sign << 31 | exponent << 23, every);
+        }
+    }
+    
+    // Zero, denormals and too small Xemics values map to 0; the largest saturate.
+    check(ieee754_to_xemics(0x00000000UL) == 0, "zero", 0);
+    check(ieee754_to_xemics(0x80000000UL) == 0, "negative zero", 0x80000000UL);
+    check(ieee754_to_xemics(0x00000001UL) == 0, "denormal", 1);
+    check(ieee754_to_xemics(0x7f000000UL) == 0xff7fffffUL, "saturate", 0x7f000000UL);
+    check(ieee754_to_xemics(0xff800000UL) == 0xffffffffUL, "saturate negative", 0xff800000UL);
+    for (uint32_t exponent = 0; exponent <= 2; exponent++) {
+        check(xemics_to_ieee754(exponent << 24 | 0x7fffff) == 0, "underflow", exponent << 24);
+    }
+    
+    const uint32_t loops = 10000000;
+    volatile uint32_t sink = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < loops; i++) {
+        sink = sink + xemics_to_ieee754(i * 2654435761UL); // Spread over every exponent
+    }
+    double integer = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / loops;
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < loops; i++) {
+        sink = sink + (reference_decode(i * 2654435761UL) > 0);
+    }
+    double reference = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / loops;
+    
+    printf("%lu values checked, %lu failures\n", checked, failures);
+    printf("decode: %.2f ns integer, %.2f ns pow()\n", integer, reference);
+    return failures ? 1 : 0;
+}